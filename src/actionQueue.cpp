@@ -0,0 +1,28 @@
+#include "actionQueue.hpp"
+
+#include <algorithm>
+
+void updateHeldButton(HeldButton& button, bool pressed, Action action, InputClock::time_point now,
+                      const AutoRepeat& repeat, std::vector<TimedAction>& queue)
+{
+    if (!pressed)
+    {
+        button.held = false;
+        return;
+    }
+
+    if (!button.held)
+    {
+        button.held = true;
+        button.nextRepeat = now + inputSeconds(repeat.das);
+        queue.push_back({now, action});
+        return;
+    }
+
+    // A zero repeat rate would queue repeats forever, so repeat at most once per millisecond.
+    auto interval = std::max(inputSeconds(repeat.arr), InputClock::duration(std::chrono::milliseconds(1)));
+    for (; button.nextRepeat <= now; button.nextRepeat += interval)
+    {
+        queue.push_back({button.nextRepeat, action});
+    }
+}
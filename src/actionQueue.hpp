@@ -0,0 +1,40 @@
+#pragma once
+
+#include "game.hpp"
+
+#include <chrono>
+#include <vector>
+
+using InputClock = std::chrono::steady_clock;
+
+inline InputClock::duration inputSeconds(float seconds)
+{
+    return std::chrono::duration_cast<InputClock::duration>(std::chrono::duration<float>(seconds));
+}
+
+// An action, stamped with when it was made, so that it can be applied in order with the ticks around it.
+struct TimedAction
+{
+    InputClock::time_point time;
+    Action action;
+};
+
+// Delayed auto-shift: a held move is repeated once it has been held for das seconds, and then every arr seconds.
+struct AutoRepeat
+{
+    float das = 0.17F;
+    float arr = 0.05F;
+};
+
+// State of a button whose action repeats while it is held.
+struct HeldButton
+{
+    bool held = false;
+    InputClock::time_point nextRepeat{};
+};
+
+// Queues the action when the button goes down, and every repeat which came due since the last update while it stays
+// down. Repeats are stamped with when they came due rather than with now, so they keep their spacing whatever the frame
+// rate.
+void updateHeldButton(HeldButton& button, bool pressed, Action action, InputClock::time_point now,
+                      const AutoRepeat& repeat, std::vector<TimedAction>& queue);
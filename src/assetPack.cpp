@@ -0,0 +1,143 @@
+#include "assetPack.hpp"
+
+#include <cubos/core/memory/buffer_stream.hpp>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using cubos::core::data::File;
+using cubos::core::memory::BufferStream;
+using cubos::core::memory::Stream;
+
+PackArchive::~PackArchive()
+{
+#if !defined(_WIN32)
+    if (mBuffer.empty() && mData != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(mData), mSize);
+    }
+#endif
+}
+
+std::unique_ptr<PackArchive> PackArchive::load(const std::string& path)
+{
+    std::unique_ptr<PackArchive> archive{new PackArchive()};
+
+#if !defined(_WIN32)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        void* mapped = mmap(nullptr, std::size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED)
+        {
+            archive->mData = static_cast<const uint8_t*>(mapped);
+            archive->mSize = std::size_t(info.st_size);
+        }
+    }
+    close(fd);
+#endif
+    if (archive->mData == nullptr)
+    {
+        if (!readFile(path, archive->mBuffer))
+        {
+            return nullptr;
+        }
+        archive->mData = archive->mBuffer.data();
+        archive->mSize = archive->mBuffer.size();
+    }
+
+    std::vector<PackEntry> entries;
+    if (!readPack(archive->mData, archive->mSize, entries))
+    {
+        return nullptr;
+    }
+
+    archive->mNodes.push_back({"", 0, 0, 0, true, nullptr, 0});
+    for (const auto& entry : entries)
+    {
+        std::size_t node = RootId;
+        std::size_t start = 0;
+        for (std::size_t slash; (slash = entry.path.find('/', start)) != std::string::npos; start = slash + 1)
+        {
+            node = archive->findOrAdd(node, entry.path.substr(start, slash - start), true);
+        }
+        node = archive->findOrAdd(node, entry.path.substr(start), false);
+        archive->mNodes[node - 1].data = archive->mData + entry.offset;
+        archive->mNodes[node - 1].size = std::size_t(entry.size);
+        archive->mFileCount++;
+    }
+    return archive;
+}
+
+std::size_t PackArchive::findOrAdd(std::size_t parent, const std::string& name, bool directory)
+{
+    for (std::size_t id = mNodes[parent - 1].child; id != 0; id = mNodes[id - 1].sibling)
+    {
+        if (mNodes[id - 1].name == name)
+        {
+            return id;
+        }
+    }
+
+    mNodes.push_back({name, parent, 0, mNodes[parent - 1].child, directory, nullptr, 0});
+    mNodes[parent - 1].child = mNodes.size();
+    return mNodes.size();
+}
+
+std::size_t PackArchive::create(std::size_t /*parent*/, std::string_view /*name*/, bool /*directory*/)
+{
+    return 0;
+}
+
+bool PackArchive::destroy(std::size_t /*id*/)
+{
+    return false;
+}
+
+std::string PackArchive::name(std::size_t id) const
+{
+    return mNodes[id - 1].name;
+}
+
+bool PackArchive::directory(std::size_t id) const
+{
+    return mNodes[id - 1].directory;
+}
+
+bool PackArchive::readOnly() const
+{
+    return true;
+}
+
+std::size_t PackArchive::parent(std::size_t id) const
+{
+    return mNodes[id - 1].parent;
+}
+
+std::size_t PackArchive::sibling(std::size_t id) const
+{
+    return mNodes[id - 1].sibling;
+}
+
+std::size_t PackArchive::child(std::size_t id) const
+{
+    return mNodes[id - 1].child;
+}
+
+std::unique_ptr<Stream> PackArchive::open(std::size_t id, File::Handle /*file*/, File::OpenMode mode)
+{
+    if (mode != File::OpenMode::Read || mNodes[id - 1].directory)
+    {
+        return nullptr;
+    }
+    return std::make_unique<BufferStream>(mNodes[id - 1].data, mNodes[id - 1].size);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "packFormat.hpp"
+
+#include <cubos/core/data/fs/archive.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Read-only archive serving the files of an asset pack straight from a memory mapping of it, so that mounting it
+// replaces the loose assets directory without reading or copying any file up front.
+class PackArchive : public cubos::core::data::Archive
+{
+public:
+    ~PackArchive() override;
+
+    // Maps the pack at the given path. Returns null if it can't be opened or isn't a valid pack.
+    static std::unique_ptr<PackArchive> load(const std::string& path);
+
+    std::size_t fileCount() const
+    {
+        return mFileCount;
+    }
+
+    std::size_t create(std::size_t parent, std::string_view name, bool directory = false) override;
+    bool destroy(std::size_t id) override;
+    std::string name(std::size_t id) const override;
+    bool directory(std::size_t id) const override;
+    bool readOnly() const override;
+    std::size_t parent(std::size_t id) const override;
+    std::size_t sibling(std::size_t id) const override;
+    std::size_t child(std::size_t id) const override;
+    std::unique_ptr<cubos::core::memory::Stream> open(std::size_t id, cubos::core::data::File::Handle file,
+                                                      cubos::core::data::File::OpenMode mode) override;
+
+private:
+    // Ids are indices into mNodes plus one, so that the root is RootId and 0 means none.
+    struct Node
+    {
+        std::string name;
+        std::size_t parent = 0;
+        std::size_t child = 0;
+        std::size_t sibling = 0;
+        bool directory = false;
+        const uint8_t* data = nullptr;
+        std::size_t size = 0;
+    };
+
+    PackArchive() = default;
+
+    std::size_t findOrAdd(std::size_t parent, const std::string& name, bool directory);
+
+    const uint8_t* mData = nullptr;
+    std::size_t mSize = 0;
+    // Holds the pack where it can't be memory mapped.
+    std::vector<uint8_t> mBuffer;
+    std::vector<Node> mNodes;
+    std::size_t mFileCount = 0;
+};
@@ -1,23 +1,50 @@
 #include "audioAudioPlugin.hpp"
 
+#include "gameLogic.hpp"
+#include "log.hpp"
+#include "profiler.hpp"
+
 #include <cubos/core/ecs/reflection.hpp>
 
 #include <cubos/engine/assets/plugin.hpp>
 
 #include <cubos/engine/audio/plugin.hpp>
 #include <cubos/engine/prelude.hpp>
+#include <cubos/engine/settings/plugin.hpp>
 #include <cubos/engine/transform/position.hpp>
 #include <cubos/engine/transform/rotation.hpp>
 #include <cubos/engine/physics/components/velocity.hpp>
 
 using namespace cubos::engine;
 
-static const Asset<Audio> BackgroundMusic = AnyAsset("assets/audio/cubosmusic.wav");
+static const Asset<Audio> BackgroundMusic = AnyAsset("/assets/audio/cubosmusic.wav");
+
+// Sound of each SfxKind.
+static const Asset<Audio> SfxSounds[SFX_KIND_COUNT] = {
+    AnyAsset("/assets/audio/lock.wav"),
+    AnyAsset("/assets/audio/clear.wav"),
+    AnyAsset("/assets/audio/gameOver.wav"),
+};
+
+// Length of each sound, in seconds, to tell when a voice is free again.
+static const float SfxSeconds[SFX_KIND_COUNT] = {0.08F, 0.25F, 0.6F};
+
+// Kinds in the order they are started when more are due in a frame than SFX_PER_FRAME allows.
+static const SfxKind SfxPriority[SFX_KIND_COUNT] = {SFX_GAME_OVER, SFX_CLEAR, SFX_LOCK};
+
+CUBOS_REFLECT_IMPL(SfxVoices)
+{
+    return cubos::core::ecs::TypeBuilder<SfxVoices>("SfxVoices").withField("ready", &SfxVoices::ready).build();
+}
 
 void audioAudioPlugin(Cubos& cubos)
 {
     cubos.depends(audioPlugin);
     cubos.depends(assetsPlugin);
+    cubos.depends(settingsPlugin);
+    cubos.depends(gameLogicPlugin);
+
+    cubos.resource<SfxVoices>();
 
     cubos.startupSystem("create an audio listener").after(audioStateInitTag).call([](Commands cmds) {
         cmds.create()
@@ -27,21 +54,116 @@ void audioAudioPlugin(Cubos& cubos)
             .add(AudioListener{true});
     });
 
-    cubos.startupSystem("create a background audio stream").after(audioStateInitTag).after(assetsTag).call([](Commands cmds, Assets& assets) {
-        cmds.create()
-            .add(Position{{8.0F, 1.0F, -2.0F}})
-            .add(Velocity{.vec = {1.0F, 1.0F, 1.0F}})
-            .add(Rotation{})
-            .add(AudioSource{ .looping = true, .gain = 0.75, .sound = BackgroundMusic })
-            .add(AudioPlay{});
-    });
+    cubos.startupSystem("create a background audio stream")
+        .after(audioStateInitTag)
+        .after(assetsTag)
+        .after(settingsTag)
+        .call([](Commands cmds, Settings& settings) {
+            if (!settings.getBool("audio.music", true))
+            {
+                return;
+            }
+            cmds.create()
+                .add(Position{{8.0F, 1.0F, -2.0F}})
+                .add(Velocity{.vec = {1.0F, 1.0F, 1.0F}})
+                .add(Rotation{})
+                .add(AudioSource{.looping = true, .gain = 0.75, .sound = BackgroundMusic})
+                .add(AudioPlay{});
+        });
+
+    // Every voice sits on the listener, so that sound effects aren't panned or attenuated.
+    cubos.startupSystem("create the sound effect voices")
+        .after(audioStateInitTag)
+        .after(assetsTag)
+        .after(settingsTag)
+        .call([](Commands cmds, Settings& settings, SfxVoices& sfx) {
+            auto gain = float(settings.getDouble("audio.sfxGain", 0.6));
+            for (int kind = 0; kind < SFX_KIND_COUNT; kind++)
+            {
+                for (auto& voice : sfx.voices[std::size_t(kind)])
+                {
+                    voice = cmds.create()
+                                .add(Position{{8.0F, 1.0F, -2.0F}})
+                                .add(AudioSource{.looping = false, .gain = gain, .sound = SfxSounds[kind]})
+                                .entity();
+                }
+            }
+            sfx.ready = true;
+        });
+
+    cubos.system("play sound effects")
+        .after(gameEventsTag)
+        .call([](Commands cmds, const DeltaTime& dt, SfxVoices& sfx, EventReader<GameEvent> events) {
+            PROFILE_SCOPE("play sound effects");
+
+            // Only the local boards are heard, so that boards played by the bot don't drown them out.
+            bool due[SFX_KIND_COUNT] = {};
+            for (const auto& event : events)
+            {
+                if (!event.local)
+                {
+                    continue;
+                }
+                if (event.type == PIECE_LOCKED)
+                {
+                    due[SFX_LOCK] = true;
+                }
+                else if (event.type == LINES_CLEARED)
+                {
+                    due[SFX_CLEAR] = true;
+                }
+                else if (event.type == GAME_ENDED)
+                {
+                    due[SFX_GAME_OVER] = true;
+                }
+            }
+            if (!sfx.ready)
+            {
+                return;
+            }
+            sfx.time += dt.value();
+
+            // Voices stopped on the last frame have had their stop applied by now.
+            for (int kind = 0; kind < SFX_KIND_COUNT; kind++)
+            {
+                int& restart = sfx.restart[std::size_t(kind)];
+                if (restart != -1)
+                {
+                    cmds.add(sfx.voices[std::size_t(kind)][std::size_t(restart)], AudioPlay{});
+                    restart = -1;
+                }
+            }
+
+            int started = 0;
+            for (SfxKind kind : SfxPriority)
+            {
+                if (!due[kind])
+                {
+                    continue;
+                }
+                if (started == SFX_PER_FRAME)
+                {
+                    GAME_TRACE("Dropped sound effect {}, already started {} this frame", int(kind), started);
+                    continue;
+                }
+                started++;
 
-    //cubos.observer("play sounds immediately")
-    //    .onAdd<AudioSource>()
-    //    .without<AudioPlay>()
-    //    .call([](Commands cmds, Query<Entity> query) {
-    //        for( auto [ ent ] : query) {
-    //            cmds.add(ent, AudioPlay{});
-    //        }
-    //    });
-}
\ No newline at end of file
+                int& next = sfx.next[kind];
+                int index = next;
+                next = (next + 1) % SFX_VOICES;
+                Entity voice = sfx.voices[kind][std::size_t(index)];
+                float& startedAt = sfx.startedAt[kind][std::size_t(index)];
+                if (startedAt != 0.0F && sfx.time - startedAt < SfxSeconds[kind])
+                {
+                    GAME_TRACE("Stealing voice {} of sound effect {}", index, int(kind));
+                    cmds.add(voice, AudioStop{});
+                    sfx.restart[kind] = index;
+                }
+                else
+                {
+                    cmds.add(voice, AudioPlay{});
+                }
+                startedAt = sfx.time;
+            }
+        });
+}
@@ -4,4 +4,37 @@
 
 #include <cubos/engine/prelude.hpp>
 
+#include <array>
+
+// Kinds of sound effects, each triggered by a game event.
+enum SfxKind
+{
+    SFX_LOCK,
+    SFX_CLEAR,
+    SFX_GAME_OVER,
+    SFX_KIND_COUNT
+};
+
+// Voices each kind of sound effect can play on at once.
+const int SFX_VOICES = 4;
+// Most sound effects started in a single frame. Events past this are dropped.
+const int SFX_PER_FRAME = 2;
+
+// Audio sources playing the sound effects, spawned once at startup with their sound already set, so that triggering
+// one only starts a voice. Voices of a kind are used in turn, so the next one is always the one which started longest
+// ago. If it is still playing it is stolen: it is stopped, and started again on the following frame.
+struct SfxVoices
+{
+    CUBOS_REFLECT;
+
+    std::array<std::array<cubos::engine::Entity, SFX_VOICES>, SFX_KIND_COUNT> voices{};
+    // Time each voice was last started at, in seconds since startup.
+    std::array<std::array<float, SFX_VOICES>, SFX_KIND_COUNT> startedAt{};
+    std::array<int, SFX_KIND_COUNT> next{};
+    // Stolen voices to start on the next frame, as indices into voices, or -1.
+    std::array<int, SFX_KIND_COUNT> restart{-1, -1, -1};
+    float time = 0.0F;
+    bool ready = false;
+};
+
 void audioAudioPlugin(cubos::engine::Cubos& cubos);
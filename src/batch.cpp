@@ -0,0 +1,179 @@
+#include "batch.hpp"
+
+#include "bot.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+bool checkGame(const Game& game)
+{
+    if (game.blockX.size() != game.blockY.size() || game.blockX.size() != game.blockZ.size())
+    {
+        return false;
+    }
+
+    // The floating piece never overlaps the board and always matches its type, orientation and pivot.
+    for (std::size_t i = 0; i < game.blockX.size(); i++)
+    {
+        int x = game.blockX[i];
+        int y = game.blockY[i];
+        int z = game.blockZ[i];
+        if (!game.board.inBounds(x, y, z) || game.board.occupied(x, y, z))
+        {
+            return false;
+        }
+        if (game.floatingPieceColor != 0)
+        {
+            const auto& block = PIECES.orientations[game.pieceType][game.pieceOrientation][i];
+            if (x != game.pieceX + block.x || y != game.pieceY + block.y || z != game.pieceZ + block.z)
+            {
+                return false;
+            }
+        }
+    }
+
+    return game.score == game.lines * 10;
+}
+
+bool checkBoard(const Board& board)
+{
+    // The incrementally kept column heights match the occupancy rows.
+    Board rebuilt = board;
+    rebuilt.rebuildHeights();
+    if (rebuilt.heights != board.heights)
+    {
+        return false;
+    }
+
+    // Every occupied cell has a color, and every empty one has none.
+    for (int y = 0; y < board.height; y++)
+    {
+        for (int z = 0; z < board.depth; z++)
+        {
+            for (int x = 0; x < board.width; x++)
+            {
+                if (board.occupied(x, y, z) != (board.color(x, y, z) != 0))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+BatchGame runBatchGame(const BatchOptions& options, uint64_t seed)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    Game game;
+    game.tickPeriod = options.tickPeriod;
+    game.ticksToLock = options.ticksToLock;
+    game.clearAllAtOnce = options.clearAllAtOnce;
+    game.cascadeGravity = options.cascadeGravity;
+    game.board = Board(options.preset);
+    seedGame(game, seed);
+
+    // Inputs are drawn from their own generator, so that they don't change the piece sequence.
+    std::mt19937 rng(static_cast<uint32_t>(seed));
+    Bot bot;
+    BotPlan plan;
+    bool broken = false;
+
+    while (!game.gameOver && game.tick < options.maxTicks)
+    {
+        if (options.policy == BATCH_POLICY_RANDOM)
+        {
+            uint32_t roll = rng() % 8;
+            if (roll < 4)
+            {
+                applyAction(game, moveAction(Direction(roll)));
+            }
+        }
+        else if (options.policy == BATCH_POLICY_BOT)
+        {
+            // Games already run in parallel, so the bot scores its placements on this thread alone.
+            if (botPlan(bot, game, nullptr, plan))
+            {
+                for (Action action : plan.actions)
+                {
+                    applyAction(game, action);
+                }
+            }
+        }
+
+        tickGame(game);
+        if (!checkGame(game))
+        {
+            broken = true;
+            break;
+        }
+    }
+
+    broken = broken || !checkBoard(game.board);
+
+    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    return {game.seed, game.score, game.tick, game.pieces, game.lines, game.gameOver, broken, nanos.count()};
+}
+
+// Fills in the given percentiles of the values, which get sorted.
+static void percentiles(std::vector<int>& values, int (&out)[6])
+{
+    const double RANKS[6] = {0.0, 0.1, 0.5, 0.9, 0.99, 1.0};
+    std::sort(values.begin(), values.end());
+    for (int i = 0; i < 6; i++)
+    {
+        out[i] = values[std::size_t(RANKS[i] * double(values.size() - 1) + 0.5)];
+    }
+}
+
+BatchResult runBatch(const BatchOptions& options, ThreadPool& pool)
+{
+    BatchResult result;
+    if (options.games <= 0)
+    {
+        return result;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    result.games.resize(std::size_t(options.games));
+    // The profiler scopes in the game logic and the bot only add to this thread's own totals, so the workers share
+    // nothing while they play.
+    pool.parallelFor(options.games, [&](int i) {
+        result.games[std::size_t(i)] = runBatchGame(options, options.firstSeed + uint64_t(i));
+    });
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<int> scores;
+    std::vector<int> ticks;
+    long long totalScore = 0;
+    int64_t totalNanos = 0;
+    for (const auto& game : result.games)
+    {
+        result.totalTicks += game.ticks;
+        result.totalPieces += game.pieces;
+        result.totalLines += game.lines;
+        result.unfinished += game.finished ? 0 : 1;
+        result.broken += game.broken ? 1 : 0;
+        totalScore += game.score;
+        totalNanos += game.nanos;
+        scores.push_back(game.score);
+        ticks.push_back(game.ticks);
+
+        std::size_t bucket = std::size_t(game.score / result.scoreBucket);
+        if (bucket >= result.scoreHistogram.size())
+        {
+            result.scoreHistogram.resize(bucket + 1, 0);
+        }
+        result.scoreHistogram[bucket]++;
+    }
+
+    result.meanScore = double(totalScore) / double(options.games);
+    result.meanTicks = double(result.totalTicks) / double(options.games);
+    result.linesPerPiece = result.totalPieces > 0 ? double(result.totalLines) / double(result.totalPieces) : 0.0;
+    result.nanosPerTick = result.totalTicks > 0 ? double(totalNanos) / double(result.totalTicks) : 0.0;
+    percentiles(scores, result.scorePercentiles);
+    percentiles(ticks, result.tickPercentiles);
+    return result;
+}
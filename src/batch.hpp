@@ -0,0 +1,87 @@
+#pragma once
+
+#include "game.hpp"
+#include "threadPool.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Runs many independent games in parallel, each on its own seed, without any engine world, and summarizes them.
+
+enum BatchPolicy
+{
+    // No inputs at all, pieces just fall.
+    BATCH_POLICY_NONE,
+    // Random moves on roughly half the ticks.
+    BATCH_POLICY_RANDOM,
+    // The placement search bot.
+    BATCH_POLICY_BOT,
+};
+
+struct BatchOptions
+{
+    int games = 1000;
+    // Game i is seeded with firstSeed + i, so the same options always give the same games.
+    uint64_t firstSeed = 1;
+    // Games still running after this many ticks are stopped and counted as unfinished.
+    int maxTicks = 100000;
+    BatchPolicy policy = BATCH_POLICY_RANDOM;
+    BoardPreset preset = BOARD_CLASSIC;
+
+    // Rules being tuned. Only ticksToLock changes the logic, while tickPeriod converts ticks into game time.
+    float tickPeriod = Game{}.tickPeriod;
+    int ticksToLock = Game{}.ticksToLock;
+    bool clearAllAtOnce = false;
+    bool cascadeGravity = false;
+};
+
+// Outcome of a single game.
+struct BatchGame
+{
+    uint64_t seed;
+    int score;
+    int ticks;
+    int pieces;
+    int lines;
+    bool finished;
+    // Set if the game broke an invariant, which points at a logic bug. Rerun the seed to reproduce it.
+    bool broken;
+    // Wall time spent in the game, in nanoseconds.
+    int64_t nanos;
+};
+
+struct BatchResult
+{
+    std::vector<BatchGame> games{};
+    double seconds = 0.0;
+
+    long long totalTicks = 0;
+    long long totalPieces = 0;
+    long long totalLines = 0;
+    int unfinished = 0;
+    int broken = 0;
+
+    double meanScore = 0.0;
+    // Score percentiles: minimum, 10th, 50th, 90th, 99th and maximum.
+    int scorePercentiles[6] = {};
+    double meanTicks = 0.0;
+    int tickPercentiles[6] = {};
+    double linesPerPiece = 0.0;
+    // Average wall time per tick, over all games, in nanoseconds.
+    double nanosPerTick = 0.0;
+    // Number of games with a score in each bucket of width scoreBucket, starting at 0.
+    int scoreBucket = 10;
+    std::vector<int> scoreHistogram{};
+};
+
+// Checks invariants of the floating piece and score which should hold between ticks. Cheap enough to run every tick.
+// Returns false if the game is in a state the rules can't reach.
+bool checkGame(const Game& game);
+// Checks that the occupancy bits, colors and column heights of every cell agree. Scans the whole board.
+bool checkBoard(const Board& board);
+
+// Plays a single game to the end, or until maxTicks.
+BatchGame runBatchGame(const BatchOptions& options, uint64_t seed);
+
+// Plays every game of the batch on the pool and aggregates the results.
+BatchResult runBatch(const BatchOptions& options, ThreadPool& pool);
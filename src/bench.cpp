@@ -0,0 +1,440 @@
+// Micro-benchmarks of the game logic kernels, over generated boards of several fill densities and hole patterns.
+//
+// Usage: game_bench [--filter TEXT] [--min-time SECONDS] [--repeats N] [--json FILE] [--baseline FILE]
+//                   [--tolerance FRACTION]
+//
+// Each benchmark is named kernel/board/pattern/density, and runs in batches until --min-time has passed, --repeats
+// times. The fastest time per call is printed, and with --json saved as
+//
+//     {"benchmarks": [{"name": "...", "nsPerOp": 12.3, "iterations": 4096}, ...]}
+//
+// The first benchmark, calibrate, is a fixed arithmetic loop which doesn't touch the game. With --baseline, the results
+// are compared against a file in that format, each scaled by its run's calibrate time so that a baseline taken on a
+// faster or slower machine still applies. The run fails if any benchmark is more than --tolerance slower than its
+// baseline (1 means twice as slow). Benchmarks missing from the baseline are reported but never fail. To update the
+// baseline, save the results of a run over it with --json.
+//
+// Kernels which change the game, such as lockFloatingBlock, restore it from a copy before each call. The restore
+// benchmark times that copy alone, so that it can be subtracted.
+//
+// The board benchmarks time the work on the board alone behind the systems which mirror it with cubes: walking the
+// dirty cells after a clear, and the landing spot of the ghost piece. The systems themselves need the engine and its
+// assets, which this tool doesn't link, so their commands and cube updates aren't included.
+
+#include "bytes.hpp"
+#include "game.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+struct BenchOptions
+{
+    std::string filter{};
+    double minTime = 0.01;
+    int repeats = 5;
+    std::string jsonPath{};
+    std::string baselinePath{};
+    double tolerance = 1.0;
+};
+
+struct BenchResult
+{
+    std::string name;
+    double nsPerOp;
+    long long iterations;
+};
+
+// How the filled cells of a generated board are laid out.
+enum HolePattern
+{
+    // Each cell of the bottom half is filled with the given probability.
+    HOLES_RANDOM,
+    // Columns are filled up to the given fraction of the board's height, except a well every third column in each
+    // direction, so that most rows are full lines.
+    HOLES_WELLS,
+    // Like random, but every third layer is empty, so that most filled cells hang over a gap.
+    HOLES_OVERHANGS,
+    HOLE_PATTERN_COUNT
+};
+
+static const char* const HOLE_PATTERN_NAMES[HOLE_PATTERN_COUNT] = {"random", "wells", "overhangs"};
+static const int DENSITIES[] = {25, 50, 75};
+
+static const char* const CALIBRATE = "calibrate";
+
+// Whatever the kernels return is added here, so that the compiler can't drop the calls.
+static volatile long long sink = 0;
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr)
+        {
+            std::fprintf(stderr, "Missing value for %s\n", arg);
+            return false;
+        }
+
+        if (std::strcmp(arg, "--filter") == 0)
+        {
+            options.filter = value;
+        }
+        else if (std::strcmp(arg, "--min-time") == 0)
+        {
+            options.minTime = std::atof(value);
+        }
+        else if (std::strcmp(arg, "--repeats") == 0)
+        {
+            options.repeats = std::max(1, std::atoi(value));
+        }
+        else if (std::strcmp(arg, "--json") == 0)
+        {
+            options.jsonPath = value;
+        }
+        else if (std::strcmp(arg, "--baseline") == 0)
+        {
+            options.baselinePath = value;
+        }
+        else if (std::strcmp(arg, "--tolerance") == 0)
+        {
+            options.tolerance = std::atof(value);
+        }
+        else
+        {
+            std::fprintf(stderr, "Unknown option %s\n", arg);
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+// A game on a generated board, with a piece spawned above the filled cells. The same arguments always give the same
+// game.
+static Game generateGame(BoardPreset preset, HolePattern pattern, int density)
+{
+    Game game;
+    game.board = Board(preset);
+    seedGame(game, uint64_t(pattern * 100 + density));
+    Board& board = game.board;
+
+    std::mt19937 rng(uint32_t(pattern * 100 + density));
+    std::uniform_int_distribution<int> percent(0, 99);
+    int filledLayers = pattern == HOLES_WELLS ? board.height * density / 100 : board.height / 2;
+    for (int y = 0; y < filledLayers; y++)
+    {
+        for (int z = 0; z < board.depth; z++)
+        {
+            for (int x = 0; x < board.width; x++)
+            {
+                bool filled;
+                switch (pattern)
+                {
+                case HOLES_WELLS:
+                    filled = x % 3 != 1 || z % 3 != 1;
+                    break;
+                case HOLES_OVERHANGS:
+                    filled = y % 3 != 2 && percent(rng) < density;
+                    break;
+                default:
+                    filled = percent(rng) < density;
+                    break;
+                }
+                if (filled)
+                {
+                    board.set(x, y, z, 1 + int(rng() % 5));
+                }
+            }
+        }
+    }
+    board.clearDirty();
+    spawnBlock(game);
+    return game;
+}
+
+// Runs fn in batches which double in size until one takes a fraction of the minimum time, and then for the minimum
+// time, repeats times. Returns the fastest time per call, which is the least disturbed by whatever else the machine
+// is doing.
+static BenchResult measure(const BenchOptions& options, const std::string& name, const std::function<void()>& fn)
+{
+    using Clock = std::chrono::steady_clock;
+
+    long long batch = 1;
+    while (true)
+    {
+        auto start = Clock::now();
+        for (long long i = 0; i < batch; i++)
+        {
+            fn();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (seconds >= options.minTime / 10.0 || batch >= (1LL << 30))
+        {
+            batch = std::max(1LL, (long long)(double(batch) * options.minTime / std::max(seconds, 1e-9)));
+            break;
+        }
+        batch *= 2;
+    }
+
+    double fastest = 0.0;
+    for (int repeat = 0; repeat < options.repeats; repeat++)
+    {
+        auto start = Clock::now();
+        for (long long i = 0; i < batch; i++)
+        {
+            fn();
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / double(batch);
+        fastest = repeat == 0 ? ns : std::min(fastest, ns);
+    }
+    return BenchResult{name, fastest, batch * options.repeats};
+}
+
+static void printResult(const BenchResult& result)
+{
+    std::printf("%-44s %12.1f ns\n", result.name.c_str(), result.nsPerOp);
+}
+
+// Every benchmark, run on a single generated game.
+static void benchGame(const BenchOptions& options, const std::string& suffix, const Game& base,
+                      std::vector<BenchResult>& results)
+{
+    auto run = [&](const char* kernel, const std::function<void()>& fn) {
+        std::string name = std::string(kernel) + "/" + suffix;
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+        {
+            return;
+        }
+        results.push_back(measure(options, name, fn));
+        printResult(results.back());
+    };
+
+    // Positions are drawn once, over the whole board, so that every branch of the bounds check is taken.
+    std::vector<int> xs, ys, zs;
+    std::mt19937 rng(1);
+    for (int i = 0; i < 256; i++)
+    {
+        xs.push_back(int(rng() % uint32_t(base.board.width + 2)) - 1);
+        ys.push_back(int(rng() % uint32_t(base.board.height + 2)) - 1);
+        zs.push_back(int(rng() % uint32_t(base.board.depth + 2)) - 1);
+    }
+    Game game = base;
+    int next = 0;
+    run("isPositionValid", [&] {
+        sink = sink + isPositionValid(game, xs[std::size_t(next)], ys[std::size_t(next)], zs[std::size_t(next)]);
+        next = (next + 1) & 255;
+    });
+
+    // Cycling through the directions keeps the piece around its spawn point.
+    int dir = 0;
+    run("moveBlock", [&] {
+        sink = sink + moveBlock(game, Direction(dir));
+        dir = (dir + 1) & 3;
+    });
+
+    run("restore", [&] { game = base; });
+    run("moveBlockDown", [&] {
+        game = base;
+        sink = sink + moveBlockDown(game);
+    });
+    run("lockFloatingBlock", [&] {
+        game = base;
+        lockFloatingBlock(game);
+    });
+    run("spawnBlock", [&] {
+        game = base;
+        spawnBlock(game);
+    });
+
+    Game cleared = base;
+    cleared.floatingPieceColor = 0;
+    cleared.blockX.clear();
+    cleared.blockY.clear();
+    cleared.blockZ.clear();
+    run("tryToClear", [&] {
+        game = cleared;
+        sink = sink + tryToClear(game);
+    });
+    cleared.clearAllAtOnce = true;
+    run("tryToClear.all", [&] {
+        game = cleared;
+        sink = sink + tryToClear(game);
+    });
+    cleared.cascadeGravity = true;
+    run("tryToClear.cascade", [&] {
+        game = cleared;
+        sink = sink + tryToClear(game);
+    });
+
+    cleared.cascadeGravity = false;
+    run("board.dirtyWalk", [&] {
+        game = cleared;
+        tryToClear(game);
+        int x, y, z;
+        for (int cell : game.board.dirtyCells)
+        {
+            game.board.cellCoords(cell, x, y, z);
+            sink = sink + game.board.occupied(x, y, z);
+        }
+        game.board.clearDirty();
+    });
+    game = base;
+    run("board.ghostDrop", [&] { sink = sink + dropDistance(game); });
+}
+
+static bool saveResults(const std::vector<BenchResult>& results, const std::string& path)
+{
+    std::string json = "{\n  \"benchmarks\": [\n";
+    char line[256];
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        std::snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"nsPerOp\": %.2f, \"iterations\": %lld}%s\n",
+                      results[i].name.c_str(), results[i].nsPerOp, results[i].iterations,
+                      i + 1 < results.size() ? "," : "");
+        json += line;
+    }
+    json += "  ]\n}\n";
+    return writeFile(path, std::vector<uint8_t>(json.begin(), json.end()));
+}
+
+// Only reads files in the format written above: every "name" is followed by its "nsPerOp".
+static bool loadResults(const std::string& path, std::vector<BenchResult>& results)
+{
+    std::vector<uint8_t> data;
+    if (!readFile(path, data))
+    {
+        return false;
+    }
+    std::string json(data.begin(), data.end());
+
+    const std::string NAME = "\"name\": \"";
+    const std::string NS = "\"nsPerOp\": ";
+    for (std::size_t pos = json.find(NAME); pos != std::string::npos; pos = json.find(NAME, pos))
+    {
+        pos += NAME.size();
+        std::size_t end = json.find('"', pos);
+        std::size_t ns = json.find(NS, pos);
+        if (end == std::string::npos || ns == std::string::npos)
+        {
+            return false;
+        }
+        results.push_back(BenchResult{json.substr(pos, end - pos), std::atof(json.c_str() + ns + NS.size()), 0});
+    }
+    return true;
+}
+
+static const BenchResult* findResult(const std::vector<BenchResult>& results, const std::string& name)
+{
+    auto it = std::find_if(results.begin(), results.end(), [&](const BenchResult& r) { return r.name == name; });
+    return it == results.end() ? nullptr : &*it;
+}
+
+// Prints every benchmark which got slower than the tolerance allows, and returns how many did. Returns -1 if either
+// side is missing the calibration.
+static int compareResults(const std::vector<BenchResult>& results, const std::vector<BenchResult>& baseline,
+                          double tolerance)
+{
+    const BenchResult* calibration = findResult(results, CALIBRATE);
+    const BenchResult* baseCalibration = findResult(baseline, CALIBRATE);
+    if (calibration == nullptr || baseCalibration == nullptr)
+    {
+        return -1;
+    }
+    double speed = baseCalibration->nsPerOp / std::max(calibration->nsPerOp, 0.01);
+    std::printf("machine:    %.2fx the speed of the baseline's\n", speed);
+
+    int regressions = 0;
+    for (const auto& result : results)
+    {
+        const BenchResult* base = findResult(baseline, result.name);
+        if (base == nullptr)
+        {
+            std::printf("new:        %s\n", result.name.c_str());
+            continue;
+        }
+        double ratio = result.nsPerOp * speed / std::max(base->nsPerOp, 0.01);
+        if (ratio > 1.0 + tolerance)
+        {
+            std::printf("regression: %s took %.1f ns, %.2fx its baseline of %.1f ns\n", result.name.c_str(),
+                        result.nsPerOp, ratio, base->nsPerOp);
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+
+    std::vector<BenchResult> results;
+    if (options.filter.empty() || !options.baselinePath.empty())
+    {
+        results.push_back(measure(options, CALIBRATE, [] {
+            uint32_t x = 2463534242U;
+            for (int i = 0; i < 1000; i++)
+            {
+                x ^= x << 13;
+                x ^= x >> 17;
+                x ^= x << 5;
+            }
+            sink = sink + x;
+        }));
+        printResult(results.back());
+    }
+    for (BoardPreset preset : {BOARD_CLASSIC, BOARD_HUGE})
+    {
+        for (int pattern = 0; pattern < HOLE_PATTERN_COUNT; pattern++)
+        {
+            for (int density : DENSITIES)
+            {
+                std::string suffix = std::string(boardPresetName(preset)) + "/" + HOLE_PATTERN_NAMES[pattern] + "/" +
+                                     std::to_string(density);
+                benchGame(options, suffix, generateGame(preset, HolePattern(pattern), density), results);
+            }
+        }
+    }
+
+    if (!options.jsonPath.empty() && !saveResults(results, options.jsonPath))
+    {
+        std::fprintf(stderr, "Could not save results to %s\n", options.jsonPath.c_str());
+        return 1;
+    }
+
+    if (!options.baselinePath.empty())
+    {
+        std::vector<BenchResult> baseline;
+        if (!loadResults(options.baselinePath, baseline))
+        {
+            std::fprintf(stderr, "Could not load the baseline from %s\n", options.baselinePath.c_str());
+            return 1;
+        }
+        int regressions = compareResults(results, baseline, options.tolerance);
+        if (regressions < 0)
+        {
+            std::fprintf(stderr, "The results or the baseline have no %s benchmark\n", CALIBRATE);
+            return 1;
+        }
+        if (regressions > 0)
+        {
+            std::printf("%d of %zu benchmarks regressed more than %.0f%%\n", regressions, results.size(),
+                        options.tolerance * 100.0);
+            return 1;
+        }
+        std::printf("No benchmark regressed more than %.0f%%\n", options.tolerance * 100.0);
+    }
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include "board.hpp"
+
+#include <cubos/core/ecs/reflection.hpp>
+#include <cubos/core/reflection/external/primitives.hpp>
+#include <cubos/core/reflection/external/vector.hpp>
+#include <cubos/core/reflection/traits/enum.hpp>
+#include <cubos/core/reflection/type.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+CUBOS_REFLECT_EXTERNAL_IMPL(BoardPreset)
+{
+    using namespace cubos::core::reflection;
+    return Type::create("BoardPreset")
+        .with(EnumTrait{}
+                  .withVariant<BOARD_SMALL>("small")
+                  .withVariant<BOARD_CLASSIC>("classic")
+                  .withVariant<BOARD_HUGE>("huge"));
+}
+
+// The preset picks the kernels every board operation dispatches to, so it has to come back with the cells. There is
+// no hook to run after a board is deserialized, so the column heights and dirty cells are kept along with the cells
+// instead of being rebuilt from them, and a board never comes back with them sized for another preset.
+CUBOS_REFLECT_IMPL(Board)
+{
+    return cubos::core::ecs::TypeBuilder<Board>("Board")
+        .withField("preset", &Board::preset)
+        .withField("width", &Board::width)
+        .withField("height", &Board::height)
+        .withField("depth", &Board::depth)
+        .withField("rows", &Board::rows)
+        .withField("colors", &Board::colors)
+        .withField("heights", &Board::heights)
+        .withField("dirtyCells", &Board::dirtyCells)
+        .withField("dirtyRows", &Board::dirtyRows)
+        .build();
+}
+
+static const char* const BOARD_PRESET_NAMES[BOARD_PRESET_COUNT] = {"small", "classic", "huge"};
+
+bool parseBoardPreset(const char* name, BoardPreset& preset)
+{
+    for (int i = 0; i < BOARD_PRESET_COUNT; i++)
+    {
+        if (std::strcmp(name, BOARD_PRESET_NAMES[i]) == 0)
+        {
+            preset = BoardPreset(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* boardPresetName(BoardPreset preset)
+{
+    return BOARD_PRESET_NAMES[preset];
+}
+
+Board::Board(BoardPreset preset)
+    : preset(preset)
+{
+    withBoardDims(preset, [this](auto dims) {
+        using Dims = decltype(dims);
+        width = Dims::WIDTH;
+        height = Dims::HEIGHT;
+        depth = Dims::DEPTH;
+    });
+    rows.assign(std::size_t(height * depth), 0);
+    colors.assign(std::size_t(cellCount()), 0);
+    dirtyRows.assign(std::size_t(height * depth), 0);
+    heights.assign(std::size_t(width * depth), 0);
+}
+
+void Board::set(int x, int y, int z, int color)
+{
+    if (colors[cellIndex(x, y, z)] == color)
+    {
+        return;
+    }
+    markDirty(x, y, z);
+
+    uint8_t& top = heights[std::size_t(z * width + x)];
+    if (color == 0)
+    {
+        row(y, z) &= BoardRow(~(1U << x));
+
+        // Emptying the top cell lowers the column to the next occupied cell below it.
+        if (y + 1 == top)
+        {
+            while (top > 0 && !occupied(x, top - 1, z))
+            {
+                top--;
+            }
+        }
+    }
+    else
+    {
+        row(y, z) |= BoardRow(1U << x);
+        top = uint8_t(std::max(int(top), y + 1));
+    }
+    colors[cellIndex(x, y, z)] = uint8_t(color);
+}
+
+void Board::markDirty(int x, int y, int z)
+{
+    BoardRow& dirtyRow = dirtyRows[rowIndex(y, z)];
+    if ((dirtyRow & (1U << x)) == 0)
+    {
+        dirtyRow |= BoardRow(1U << x);
+        dirtyCells.push_back(cellIndex(x, y, z));
+    }
+}
+
+void Board::markAllDirty()
+{
+    for (int y = 0; y < height; ++y)
+    {
+        for (int z = 0; z < depth; ++z)
+        {
+            for (BoardRow bits = row(y, z); bits != 0; bits &= BoardRow(bits - 1))
+            {
+                markDirty(std::countr_zero(bits), y, z);
+            }
+        }
+    }
+}
+
+void Board::markChangedFrom(const Board& other)
+{
+    int x, y, z;
+    for (int cell = 0; cell < cellCount(); cell++)
+    {
+        if (colors[std::size_t(cell)] != other.colors[std::size_t(cell)])
+        {
+            cellCoords(cell, x, y, z);
+            markDirty(x, y, z);
+        }
+    }
+    for (int cell : other.dirtyCells)
+    {
+        cellCoords(cell, x, y, z);
+        markDirty(x, y, z);
+    }
+}
+
+void Board::clearDirty()
+{
+    dirtyCells.clear();
+    std::fill(dirtyRows.begin(), dirtyRows.end(), BoardRow(0));
+}
+
+void Board::clear()
+{
+    for (int rowIndex = 0; rowIndex < int(rows.size()); rowIndex++)
+    {
+        for (BoardRow bits = rows[std::size_t(rowIndex)]; bits != 0; bits &= BoardRow(bits - 1))
+        {
+            int cell = rowIndex * width + std::countr_zero(bits);
+            int x, y, z;
+            cellCoords(cell, x, y, z);
+            markDirty(x, y, z);
+            colors[std::size_t(cell)] = 0;
+        }
+    }
+    std::fill(rows.begin(), rows.end(), BoardRow(0));
+    std::fill(heights.begin(), heights.end(), uint8_t(0));
+}
+
+void Board::rebuildHeights()
+{
+    heights.assign(std::size_t(width * depth), 0);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int z = 0; z < depth; ++z)
+        {
+            for (BoardRow bits = row(y, z); bits != 0; bits &= BoardRow(bits - 1))
+            {
+                heights[std::size_t(z * width + std::countr_zero(bits))] = uint8_t(y + 1);
+            }
+        }
+    }
+}
+
+template <typename Dims>
+static bool fitsKernel(const BoardRow* rows, const int* xs, const int* ys, const int* zs, int count, int dx, int dy,
+                       int dz)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int x = xs[i] + dx;
+        int y = ys[i] + dy;
+        int z = zs[i] + dz;
+
+        // Unsigned comparisons check both ends of each range at once.
+        if (unsigned(x) >= unsigned(Dims::WIDTH) || unsigned(y) >= unsigned(Dims::HEIGHT) ||
+            unsigned(z) >= unsigned(Dims::DEPTH) || (rows[y * Dims::DEPTH + z] & (1U << x)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Board::fits(const int* xs, const int* ys, const int* zs, int count, int dx, int dy, int dz) const
+{
+    return withBoardDims(preset, [&](auto dims) {
+        return fitsKernel<decltype(dims)>(rows.data(), xs, ys, zs, count, dx, dy, dz);
+    });
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cubos/core/reflection/reflect.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// One bit per x coordinate of a row of cells.
+using BoardRow = uint16_t;
+
+// Largest supported dimensions. Rows are BoardRow bitmasks, and line and column masks are 32 bits wide.
+const int BOARD_MAX_WIDTH = 16;  // x
+const int BOARD_MAX_HEIGHT = 32; // y
+const int BOARD_MAX_DEPTH = 32;  // z
+
+// Board dimensions as compile-time constants, which the collision and line clear kernels are specialized on so that
+// their loops have fixed trip counts.
+template <int W, int H, int D>
+struct BoardDims
+{
+    static_assert(W > 0 && W <= BOARD_MAX_WIDTH && H > 0 && H <= BOARD_MAX_HEIGHT && D > 0 && D <= BOARD_MAX_DEPTH,
+                  "board dimensions out of range");
+
+    static constexpr int WIDTH = W;
+    static constexpr int HEIGHT = H;
+    static constexpr int DEPTH = D;
+    static constexpr BoardRow FULL_ROW = BoardRow((1U << W) - 1);
+};
+
+enum BoardPreset
+{
+    BOARD_SMALL,
+    BOARD_CLASSIC,
+    BOARD_HUGE,
+    BOARD_PRESET_COUNT
+};
+
+CUBOS_REFLECT_EXTERNAL_DECL(, BoardPreset);
+
+using SmallBoard = BoardDims<6, 12, 6>;
+using ClassicBoard = BoardDims<10, 20, 10>;
+using HugeBoard = BoardDims<16, 32, 16>;
+
+// Calls fn with a value of the BoardDims type of the preset, so that a generic lambda gets one instantiation per size.
+template <typename F>
+decltype(auto) withBoardDims(BoardPreset preset, F&& fn)
+{
+    switch (preset)
+    {
+    case BOARD_SMALL:
+        return fn(SmallBoard{});
+    case BOARD_HUGE:
+        return fn(HugeBoard{});
+    default:
+        return fn(ClassicBoard{});
+    }
+}
+
+// Parses "small", "classic" or "huge". Returns false, leaving preset alone, for anything else.
+bool parseBoardPreset(const char* name, BoardPreset& preset);
+const char* boardPresetName(BoardPreset preset);
+
+// Flat board storage. Occupancy is kept as a bitboard with one row per (y, z) pair, where bit x is set if the cell is
+// occupied, so that collision and line checks are just mask operations. Colors are kept in a separate byte plane,
+// laid out the same way, which is only touched when cells are written or rendered.
+//
+// The size is picked from a preset when the board is created. Hot kernels dispatch on the preset to a version compiled
+// for its dimensions, while everything else reads the dimensions below.
+struct Board
+{
+    CUBOS_REFLECT;
+
+    BoardPreset preset = BOARD_CLASSIC;
+    int width = ClassicBoard::WIDTH;   // x
+    int height = ClassicBoard::HEIGHT; // y
+    int depth = ClassicBoard::DEPTH;   // z
+
+    std::vector<BoardRow> rows = std::vector<BoardRow>(std::size_t(height * depth), 0);
+    std::vector<uint8_t> colors = std::vector<uint8_t>(std::size_t(height * depth * width), 0);
+
+    // Cells whose color changed since the last call to clearDirty, by cell index. Each cell appears at most once,
+    // which is tracked through a bitboard with the same layout as rows.
+    std::vector<int> dirtyCells{};
+    std::vector<BoardRow> dirtyRows = std::vector<BoardRow>(std::size_t(height * depth), 0);
+
+    // Height of each column, one above its topmost occupied cell, indexed by z * width + x. Kept up to date by set,
+    // so that landing spots can be found without scanning the board.
+    std::vector<uint8_t> heights = std::vector<uint8_t>(std::size_t(width * depth), 0);
+
+    Board() = default;
+    explicit Board(BoardPreset preset);
+
+    int cellCount() const
+    {
+        return width * height * depth;
+    }
+
+    bool inBounds(int x, int y, int z) const
+    {
+        return x >= 0 && x < width && y >= 0 && y < height && z >= 0 && z < depth;
+    }
+
+    int rowIndex(int y, int z) const
+    {
+        return y * depth + z;
+    }
+
+    int cellIndex(int x, int y, int z) const
+    {
+        return rowIndex(y, z) * width + x;
+    }
+
+    void cellCoords(int index, int& x, int& y, int& z) const
+    {
+        x = index % width;
+        z = (index / width) % depth;
+        y = index / (width * depth);
+    }
+
+    BoardRow& row(int y, int z)
+    {
+        return rows[std::size_t(rowIndex(y, z))];
+    }
+
+    BoardRow row(int y, int z) const
+    {
+        return rows[std::size_t(rowIndex(y, z))];
+    }
+
+    bool occupied(int x, int y, int z) const
+    {
+        return (row(y, z) >> x) & 1U;
+    }
+
+    int color(int x, int y, int z) const
+    {
+        return colors[std::size_t(cellIndex(x, y, z))];
+    }
+
+    int columnHeight(int x, int z) const
+    {
+        return heights[std::size_t(z * width + x)];
+    }
+
+    // Sets the color of a cell. A color of 0 empties it.
+    void set(int x, int y, int z, int color);
+
+    void markDirty(int x, int y, int z);
+
+    // Marks every occupied cell as dirty, so that anything mirroring the board rebuilds it from scratch.
+    void markAllDirty();
+
+    // Marks every cell whose color differs on the other board, which must be the same size, along with the cells still
+    // dirty on it. Used when the board is replaced as a whole, so that anything mirroring it only updates what changed,
+    // including changes to the old board it hadn't caught up with yet.
+    void markChangedFrom(const Board& other);
+
+    void clearDirty();
+
+    // Empties every cell, marking the ones which were filled as dirty. Only touches the occupied cells' colors.
+    void clear();
+
+    // Recomputes every column height from the occupancy rows, for boards whose rows were written directly.
+    void rebuildHeights();
+
+    // Checks if every given block, offset by (dx, dy, dz), is inside the board and on an empty cell.
+    bool fits(const int* xs, const int* ys, const int* zs, int count, int dx, int dy, int dz) const;
+};
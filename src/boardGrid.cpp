@@ -0,0 +1,119 @@
+#include "boardGrid.hpp"
+
+#include "gameLogic.hpp"
+#include "log.hpp"
+#include "profiler.hpp"
+#include "utils.hpp"
+
+#include <cubos/core/ecs/reflection.hpp>
+#include <cubos/core/reflection/external/primitives.hpp>
+
+#include <cubos/engine/assets/plugin.hpp>
+#include <cubos/engine/render/voxels/grid.hpp>
+#include <cubos/engine/settings/plugin.hpp>
+#include <cubos/engine/transform/plugin.hpp>
+
+using namespace cubos::engine;
+
+CUBOS_REFLECT_IMPL(BoardGrid)
+{
+    return cubos::core::ecs::TypeBuilder<BoardGrid>("BoardGrid").withField("enabled", &BoardGrid::enabled).build();
+}
+
+CUBOS_REFLECT_IMPL(BoardGridView)
+{
+    return cubos::core::ecs::TypeBuilder<BoardGridView>("BoardGridView").build();
+}
+
+CUBOS_REFLECT_IMPL(BoardGridRenderer)
+{
+    return cubos::core::ecs::TypeBuilder<BoardGridRenderer>("BoardGridRenderer")
+        .withField("board", &BoardGridRenderer::board)
+        .build();
+}
+
+void bakeBoard(const Board& board, VoxelGrid& grid)
+{
+    for (int y = 0; y < board.height; y++)
+    {
+        for (int z = 0; z < board.depth; z++)
+        {
+            for (int x = 0; x < board.width; x++)
+            {
+                grid.set(glm::uvec3(x, y, z), uint16_t(board.color(x, y, z)));
+            }
+        }
+    }
+}
+
+void boardGridPlugin(Cubos& cubos)
+{
+    cubos.depends(assetsPlugin);
+    cubos.depends(settingsPlugin);
+    cubos.depends(transformPlugin);
+    cubos.depends(gameLogicPlugin);
+
+    cubos.resource<BoardGrid>();
+    cubos.component<BoardGridView>();
+    cubos.component<BoardGridRenderer>();
+
+    cubos.startupSystem("configure the board grid").after(settingsTag).call([](Settings& settings, BoardGrid& grid) {
+        grid.enabled = settings.getBool("board.voxelGrid", false);
+    });
+
+    cubos.observer("add a grid to new boards").onAdd<GameBoard>().call([](Commands cmds, Query<Entity> boards) {
+        for (auto [board] : boards)
+        {
+            cmds.add(board, BoardGridView{});
+        }
+    });
+
+    // The grid is handed to the voxel renderer as a whole, which merges the faces of adjacent voxels with the same
+    // material, so same-colored cells end up sharing quads and the cost scales with the board's surface instead of
+    // its cell count.
+    cubos.system("update the board grid")
+        .call([](Commands cmds, Assets& assets, const BoardGrid& grid,
+                 Query<Entity, const GameBoard&, Game&, BoardGridView&> boards) {
+            PROFILE_SCOPE("update the board grid");
+
+            if (!grid.enabled)
+            {
+                return;
+            }
+
+            for (auto [entity, board, game, view] : boards)
+            {
+                if (view.asset.isNull())
+                {
+                    // Bake the whole board on the first frame, and spawn the entity which renders it.
+                    VoxelGrid voxels{glm::uvec3(game.board.width, game.board.height, game.board.depth)};
+                    bakeBoard(game.board, voxels);
+                    view.asset = assets.create(std::move(voxels));
+
+                    GAME_INFO("Spawning the grid of board {}", board.index);
+                    cmds.create()
+                        .add(BoardGridRenderer{entity})
+                        .add(RenderVoxelGrid{view.asset, {0.0F, 0.0F, 0.0F}})
+                        .add(Position{board.origin + gridToWorld(game.board, 0, 0, 0)})
+                        .add(Scale{CUBE_SCALE});
+                    game.board.clearDirty();
+                    continue;
+                }
+
+                if (game.board.dirtyCells.empty())
+                {
+                    continue;
+                }
+
+                // Only patch the cells that changed, the renderer re-meshes the grid once it's written.
+                auto voxels = assets.write(view.asset);
+                int x, y, z;
+                for (int cell : game.board.dirtyCells)
+                {
+                    game.board.cellCoords(cell, x, y, z);
+                    voxels->set(glm::uvec3(x, y, z), uint16_t(game.board.color(x, y, z)));
+                }
+                game.board.clearDirty();
+            }
+        });
+}
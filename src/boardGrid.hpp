@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cubos/engine/prelude.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+#include "board.hpp"
+
+// Settings for drawing the locked board as a single voxel grid, with one voxel per cell, instead of one cube entity
+// per cell. Enabled through the "board.voxelGrid" setting.
+struct BoardGrid
+{
+    CUBOS_REFLECT;
+
+    bool enabled = false;
+};
+
+// The grid a board is baked into, added to each board when it is spawned.
+struct BoardGridView
+{
+    CUBOS_REFLECT;
+
+    cubos::engine::Asset<cubos::engine::VoxelGrid> asset{};
+};
+
+// Marks the entity which renders the grid of a board.
+struct BoardGridRenderer
+{
+    CUBOS_REFLECT;
+
+    cubos::engine::Entity board{};
+};
+
+// Writes every cell of the board into the grid, using board colors as palette indices.
+void bakeBoard(const Board& board, cubos::engine::VoxelGrid& grid);
+
+void boardGridPlugin(cubos::engine::Cubos& cubos);
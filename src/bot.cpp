@@ -0,0 +1,199 @@
+#include "bot.hpp"
+
+#include "lineClear.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+
+// A position of the floating piece during the search.
+struct BotState
+{
+    int8_t orientation;
+    int8_t x;
+    int8_t y;
+    int8_t z;
+};
+
+static int stateIndex(const Board& board, const BotState& s)
+{
+    return (s.orientation * board.height + s.y) * board.depth * board.width + board.cellIndex(s.x, 0, s.z);
+}
+
+// Scores the board after locking the piece in the given position.
+static float scorePlacement(const Board& board, int type, const BotState& s, const BotWeights& weights)
+{
+    // Each thread scores on its own copy of the board, which keeps its storage between placements.
+    static thread_local Board scratch;
+    scratch = board;
+
+    for (const auto& block : PIECES.orientations[type][s.orientation])
+    {
+        scratch.set(s.x + block.x, s.y + block.y, s.z + block.z, 1);
+    }
+    LineClearResult lines = findFullLines(scratch);
+    clearLines(scratch, lines);
+    scratch.clearDirty();
+
+    int heights[BOARD_MAX_WIDTH][BOARD_MAX_DEPTH] = {};
+    int holes = 0;
+    for (int y = 0; y < board.height; y++)
+    {
+        for (int z = 0; z < board.depth; z++)
+        {
+            for (BoardRow bits = scratch.row(y, z); bits != 0; bits &= BoardRow(bits - 1))
+            {
+                int x = std::countr_zero(bits);
+                // Every empty cell between the previous top of the column and this block is a hole.
+                holes += y - heights[x][z];
+                heights[x][z] = y + 1;
+            }
+        }
+    }
+
+    int height = 0;
+    int maxHeight = 0;
+    int bumpiness = 0;
+    for (int x = 0; x < board.width; x++)
+    {
+        for (int z = 0; z < board.depth; z++)
+        {
+            height += heights[x][z];
+            maxHeight = std::max(maxHeight, heights[x][z]);
+            if (x + 1 < board.width)
+            {
+                bumpiness += std::abs(heights[x][z] - heights[x + 1][z]);
+            }
+            if (z + 1 < board.depth)
+            {
+                bumpiness += std::abs(heights[x][z] - heights[x][z + 1]);
+            }
+        }
+    }
+
+    return weights.lines * float(lines.count) + weights.holes * float(holes) + weights.height * float(height) +
+           weights.maxHeight * float(maxHeight) + weights.bumpiness * float(bumpiness);
+}
+
+bool planPlacement(const Game& game, const BotWeights& weights, ThreadPool* pool, BotPlan& plan)
+{
+    PROFILE_SCOPE("bot: plan");
+
+    plan.actions.clear();
+    plan.placements = 0;
+    if (game.floatingPieceColor == 0)
+    {
+        return false;
+    }
+
+    const Board& board = game.board;
+    int type = game.pieceType;
+
+    // Breadth-first search over every position reachable from the current one, remembering how each was reached.
+    const int stateCount = MAX_ORIENTATIONS * board.cellCount();
+    std::vector<int> parent(stateCount, -1);
+    std::vector<int8_t> via(stateCount, -1);
+    std::vector<BotState> queue;
+
+    BotState start{int8_t(game.pieceOrientation), int8_t(game.pieceX), int8_t(game.pieceY), int8_t(game.pieceZ)};
+    parent[stateIndex(board, start)] = stateIndex(board, start);
+    queue.push_back(start);
+
+    for (std::size_t next = 0; next < queue.size(); next++)
+    {
+        BotState from = queue[next];
+        for (int action = 0; action <= ACTION_ROTATE_Z_CCW; action++)
+        {
+            BotState to = from;
+            if (action <= ACTION_MOVE_WEST)
+            {
+                const int dx[] = {1, 0, -1, 0};
+                const int dz[] = {0, 1, 0, -1};
+                to.x = int8_t(from.x + dx[action]);
+                to.z = int8_t(from.z + dz[action]);
+                if (!pieceFits(board, type, to.orientation, to.x, to.y, to.z))
+                {
+                    continue;
+                }
+            }
+            else
+            {
+                int turn = action - ACTION_ROTATE_X_CW;
+                to.orientation = int8_t(PIECES.rotations[type][from.orientation][turn / 2][turn % 2]);
+                int x = from.x;
+                int y = from.y;
+                int z = from.z;
+                if (!kickPiece(board, type, to.orientation, x, y, z))
+                {
+                    continue;
+                }
+                to.x = int8_t(x);
+                to.y = int8_t(y);
+                to.z = int8_t(z);
+            }
+
+            int index = stateIndex(board, to);
+            if (parent[index] == -1)
+            {
+                parent[index] = stateIndex(board, from);
+                via[index] = int8_t(action);
+                queue.push_back(to);
+            }
+        }
+    }
+
+    // Drop every reached position straight down, keeping the first way found to reach each landing spot.
+    std::vector<BotState> placements;
+    std::vector<int> origins;
+    std::vector<uint8_t> seen(stateCount, 0);
+    for (const auto& state : queue)
+    {
+        BotState landed = state;
+        landed.y = int8_t(state.y - dropDistance(board, type, state.orientation, state.x, state.y, state.z));
+        if (!seen[stateIndex(board, landed)])
+        {
+            seen[stateIndex(board, landed)] = 1;
+            placements.push_back(landed);
+            origins.push_back(stateIndex(board, state));
+        }
+    }
+
+    std::vector<float> scores(placements.size());
+    auto score = [&](int i) { scores[i] = scorePlacement(board, type, placements[i], weights); };
+    if (pool != nullptr)
+    {
+        pool->parallelFor(int(placements.size()), score);
+    }
+    else
+    {
+        for (int i = 0; i < int(placements.size()); i++)
+        {
+            score(i);
+        }
+    }
+
+    auto best = std::max_element(scores.begin(), scores.end()) - scores.begin();
+    plan.score = scores[best];
+    plan.placements = int(placements.size());
+
+    // Walk back from the chosen position to the start to recover the inputs.
+    for (int index = origins[best]; parent[index] != index; index = parent[index])
+    {
+        plan.actions.push_back(Action(via[index]));
+    }
+    std::reverse(plan.actions.begin(), plan.actions.end());
+    plan.actions.push_back(ACTION_HARD_DROP);
+    return true;
+}
+
+bool botPlan(Bot& bot, const Game& game, ThreadPool* pool, BotPlan& plan)
+{
+    if (game.floatingPieceColor == 0 || bot.plannedPiece == game.pieces)
+    {
+        return false;
+    }
+    bot.plannedPiece = game.pieces;
+    return planPlacement(game, bot.weights, pool, plan);
+}
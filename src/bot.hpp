@@ -0,0 +1,44 @@
+#pragma once
+
+#include "game.hpp"
+#include "threadPool.hpp"
+
+#include <vector>
+
+// Weights of each board feature in the bot's evaluation of a placement. Higher scores are better.
+struct BotWeights
+{
+    float lines = 8.0F;
+    // Empty cells with a block somewhere above them.
+    float holes = -6.0F;
+    // Sum of the heights of every column.
+    float height = -0.3F;
+    float maxHeight = -1.0F;
+    // Sum of the height differences between neighbouring columns.
+    float bumpiness = -0.4F;
+};
+
+// Inputs which take the floating piece to the best placement found, ending with a hard drop.
+struct BotPlan
+{
+    std::vector<Action> actions{};
+    float score = 0.0F;
+    // Number of distinct placements evaluated.
+    int placements = 0;
+};
+
+// Autoplayer which places each piece as soon as it spawns.
+struct Bot
+{
+    BotWeights weights{};
+    // Value of Game::pieces when the bot last planned, so that each piece is only planned for once.
+    int plannedPiece = -1;
+};
+
+// Finds every placement the floating piece can reach through moves and rotations, followed by a straight drop, and
+// scores each of them in parallel on the pool, or on the calling thread if pool is null. Returns false if there is no
+// floating piece.
+bool planPlacement(const Game& game, const BotWeights& weights, ThreadPool* pool, BotPlan& plan);
+
+// Plans for the floating piece if it hasn't been planned for yet. Returns false if there's nothing to do.
+bool botPlan(Bot& bot, const Game& game, ThreadPool* pool, BotPlan& plan);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Helpers shared by the binary file formats: little endian integers, variable length integers and whole file I/O.
+
+inline void writeLE(std::vector<uint8_t>& out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        out.push_back(uint8_t(value >> (8 * i)));
+    }
+}
+
+inline uint64_t readLE(const uint8_t* in, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+    {
+        value |= uint64_t(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+// Seven bits per byte, low bits first, with the top bit set on every byte but the last.
+inline void writeVarint(std::vector<uint8_t>& out, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
+
+inline bool readVarint(const std::vector<uint8_t>& in, std::size_t& pos, uint32_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35 && pos < in.size(); shift += 7)
+    {
+        uint8_t byte = in[pos++];
+        value |= uint32_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 32-bit FNV-1a hash, used as a checksum by the file formats and to compare game states.
+inline uint32_t fnv1a(const uint8_t* data, std::size_t size, uint32_t hash = 2166136261U)
+{
+    for (std::size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * 16777619U;
+    }
+    return hash;
+}
+
+bool writeFile(const std::string& path, const std::vector<uint8_t>& data);
+bool readFile(const std::string& path, std::vector<uint8_t>& data);
@@ -1,6 +1,7 @@
 #include "camera.hpp"
 
 #include "gameLogic.hpp"
+#include "profiler.hpp"
 #include "utils.hpp"
 
 #include <cubos/core/ecs/reflection.hpp>
@@ -43,6 +44,69 @@ Direction getDominantDirection(glm::vec3 direction)
     return maxElement->second;
 }
 
+// Queues the actions for a local board from the keyboard, relative to where the camera looks from.
+static void queuePlayerInput(const Input& input, PlayerInput& playerInput, Autoplay& autoplay,
+                             Query<const Position&>& cameraQuery)
+{
+    if (input.justPressed("autoplay"))
+    {
+        autoplay.enabled = !autoplay.enabled;
+        autoplay.bot.plannedPiece = -1;
+    }
+    if (autoplay.enabled)
+    {
+        // The bot plays from inside the logic step.
+        return;
+    }
+
+    // There should only be one camera, so we get the first result.
+    if (cameraQuery.empty())
+    {
+        return; // No camera found.
+    }
+    auto [cameraPos] = *cameraQuery.begin();
+
+    // --- Calculate Camera-Relative Direction Vectors ---
+    const glm::vec3 CENTER_POS = {0.0f, 0.0f, 0.0f};
+
+    // 1. Get the camera's "look" direction and project it onto the XZ plane.
+    glm::vec3 forward = CENTER_POS - cameraPos.vec;
+    forward.y = 0.0f; // Ignore vertical component for planar movement.
+    forward = glm::normalize(forward);
+
+    // 2. Get the camera's "right" direction using the cross product.
+    glm::vec3 right = glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), forward));
+
+    // --- Handle Input ---
+    // Actions are only queued here, and applied by the logic step in the order they were made. Moves repeat while their
+    // button is held.
+    auto now = InputClock::now();
+    auto& queue = playerInput.queue;
+    const char* moveButtons[] = {"up", "down", "right", "left"};
+    const glm::vec3 moveDirections[] = {forward, -forward, -right, right}; // -forward is towards the camera
+    for (int i = 0; i < 4; i++)
+    {
+        updateHeldButton(playerInput.moves[i], input.pressed(moveButtons[i]),
+                         moveAction(getDominantDirection(moveDirections[i])), now, playerInput.repeat, queue);
+    }
+    if (input.justPressed("rotate-yaw"))
+    {
+        queue.push_back({now, ACTION_ROTATE_Y_CW});
+    }
+    if (input.justPressed("rotate-pitch"))
+    {
+        queue.push_back({now, rotateAction(getDominantDirection(-right))});
+    }
+    if (input.justPressed("rotate-roll"))
+    {
+        queue.push_back({now, rotateAction(getDominantDirection(forward))});
+    }
+    if (input.justPressed("hard-drop"))
+    {
+        queue.push_back({now, ACTION_HARD_DROP});
+    }
+}
+
 void cameraPlugin(Cubos& cubos)
 {
     cubos.depends(inputPlugin);
@@ -51,46 +115,25 @@ void cameraPlugin(Cubos& cubos)
 
     // Why am I making this system in the camera plugin? Who knows
     cubos.system("move blocks")
-        .call([](const Game& game, const Input& input, Query<const Position&> cameraQuery) {
-            // There should only be one camera, so we get the first result.
-            if (cameraQuery.empty())
-            {
-                return; // No camera found.
-            }
-            auto [cameraPos] = *cameraQuery.begin();
+        .before(gameLogicTag)
+        .call([](Query<const GameBoard&, GameRecorder&, PlayerInput&, Autoplay&> boards, const Input& input,
+                 Query<const Position&> cameraQuery) {
+            PROFILE_SCOPE("move blocks");
 
-            // --- Calculate Camera-Relative Direction Vectors ---
-            const glm::vec3 CENTER_POS = {0.0f, 0.0f, 0.0f};
-
-            // 1. Get the camera's "look" direction and project it onto the XZ plane.
-            glm::vec3 forward = CENTER_POS - cameraPos.vec;
-            forward.y = 0.0f; // Ignore vertical component for planar movement.
-            forward = glm::normalize(forward);
-
-            // 2. Get the camera's "right" direction using the cross product.
-            glm::vec3 right = glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), forward));
-
-            // --- Handle Input ---
-            if (input.justPressed("up"))
+            for (auto [board, recorder, playerInput, autoplay] : boards)
             {
-                moveBlock(const_cast<Game&>(game), getDominantDirection(forward));
-            }
-            if (input.justPressed("down"))
-            {
-                moveBlock(const_cast<Game&>(game), getDominantDirection(-forward)); // -forward is towards the camera
-            }
-            if (input.justPressed("right"))
-            {
-                moveBlock(const_cast<Game&>(game), getDominantDirection(-right));
-            }
-            if (input.justPressed("left"))
-            {
-                moveBlock(const_cast<Game&>(game), getDominantDirection(right));
+                // While replaying, the recording drives the game instead of the player.
+                if (board.local && !recorder.isReplaying())
+                {
+                    queuePlayerInput(input, playerInput, autoplay, cameraQuery);
+                }
             }
     });
 
     cubos.system("rotate camera")
         .call([](Commands cmds, const Input& input, Query<PerspectiveCamera&, Position&, Rotation&> camera) {
+            PROFILE_SCOPE("rotate camera");
+
             // Get both horizontal and vertical mouse movement.
             glm::vec2 mouseDelta = input.mouseDelta();
 
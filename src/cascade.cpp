@@ -0,0 +1,217 @@
+#include "cascade.hpp"
+
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+// Storage reused between calls, one per thread, so that clearing doesn't allocate once it has warmed up.
+struct CascadeScratch
+{
+    // Cells visited by the current call are stamped with its number, so the marks never have to be cleared.
+    std::vector<uint32_t> visited{};
+    std::vector<int> groupOf{};
+    uint32_t stamp = 0;
+
+    std::vector<int> removed{};
+    std::vector<int> stack{};
+    // Cells of the hanging groups, one after the other, with their colors. Group g holds the cells from
+    // groupStart[g] to groupStart[g + 1].
+    std::vector<int> cells{};
+    std::vector<uint8_t> colors{};
+    std::vector<int> groupStart{};
+    std::vector<bool> landed{};
+};
+
+// Face neighbors of a cell. Down is last, so that it is pushed last and searched first, which finds groups resting on
+// the floor quickly.
+static const int NEIGHBORS[6][3] = {{0, 1, 0}, {1, 0, 0}, {-1, 0, 0}, {0, 0, 1}, {0, 0, -1}, {0, -1, 0}};
+
+static void nextStamp(CascadeScratch& scratch, int cellCount)
+{
+    if (scratch.visited.size() != std::size_t(cellCount) || ++scratch.stamp == 0)
+    {
+        scratch.visited.assign(std::size_t(cellCount), 0);
+        scratch.groupOf.assign(std::size_t(cellCount), 0);
+        scratch.stamp = 1;
+    }
+}
+
+// Flood fills the group of the given cell. Returns true, leaving it partially labeled, as soon as it reaches the floor
+// or a group labeled before it, which can only be one that rests on the floor. Otherwise its cells are left at the end
+// of scratch.cells.
+static bool floodFill(const Board& board, CascadeScratch& scratch, int seed, int group, int& visitedCount)
+{
+    std::size_t start = scratch.cells.size();
+    scratch.stack.clear();
+    scratch.stack.push_back(seed);
+    scratch.visited[std::size_t(seed)] = scratch.stamp;
+    scratch.groupOf[std::size_t(seed)] = group;
+
+    int x, y, z;
+    while (!scratch.stack.empty())
+    {
+        int cell = scratch.stack.back();
+        scratch.stack.pop_back();
+        scratch.cells.push_back(cell);
+        visitedCount++;
+
+        board.cellCoords(cell, x, y, z);
+        if (y == 0)
+        {
+            scratch.cells.resize(start);
+            return true;
+        }
+        for (const auto& offset : NEIGHBORS)
+        {
+            int nx = x + offset[0];
+            int ny = y + offset[1];
+            int nz = z + offset[2];
+            if (!board.inBounds(nx, ny, nz) || !board.occupied(nx, ny, nz))
+            {
+                continue;
+            }
+            int next = board.cellIndex(nx, ny, nz);
+            if (scratch.visited[std::size_t(next)] == scratch.stamp)
+            {
+                if (scratch.groupOf[std::size_t(next)] != group)
+                {
+                    scratch.cells.resize(start);
+                    return true;
+                }
+                continue;
+            }
+            scratch.visited[std::size_t(next)] = scratch.stamp;
+            scratch.groupOf[std::size_t(next)] = group;
+            scratch.stack.push_back(next);
+        }
+    }
+    return false;
+}
+
+// Checks if every cell of the group can move down by one more layer than it already fell.
+static bool canFall(const Board& board, const CascadeScratch& scratch, int group, int fallen)
+{
+    int x, y, z;
+    for (int i = scratch.groupStart[std::size_t(group)]; i < scratch.groupStart[std::size_t(group) + 1]; i++)
+    {
+        board.cellCoords(scratch.cells[std::size_t(i)], x, y, z);
+        int below = y - fallen - 1;
+        if (below < 0 || board.occupied(x, below, z))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+CascadeResult clearLinesCascade(Board& board, const LineClearResult& lines)
+{
+    PROFILE_SCOPE("logic: cascade");
+
+    static thread_local CascadeScratch scratch;
+    CascadeResult result;
+    if (lines.count == 0)
+    {
+        return result;
+    }
+
+    scratch.removed.clear();
+    for (int y = 0; y < board.height; ++y)
+    {
+        for (LineMask zs = lines.xLines[y]; zs != 0; zs &= zs - 1)
+        {
+            for (int x = 0; x < board.width; ++x)
+            {
+                scratch.removed.push_back(board.cellIndex(x, y, std::countr_zero(zs)));
+            }
+        }
+        for (LineMask xs = lines.zLines[y]; xs != 0; xs &= xs - 1)
+        {
+            for (int z = 0; z < board.depth; ++z)
+            {
+                scratch.removed.push_back(board.cellIndex(std::countr_zero(xs), y, z));
+            }
+        }
+    }
+    int x, y, z;
+    for (int cell : scratch.removed)
+    {
+        board.cellCoords(cell, x, y, z);
+        board.set(x, y, z, 0);
+    }
+
+    // Only groups which touched a removed cell can have lost what held them up. Every flood gets its own label, and
+    // the hanging ones are also kept in groupStart.
+    nextStamp(scratch, board.cellCount());
+    scratch.cells.clear();
+    scratch.groupStart.assign(1, 0);
+    int label = 0;
+    for (int cell : scratch.removed)
+    {
+        board.cellCoords(cell, x, y, z);
+        for (const auto& offset : NEIGHBORS)
+        {
+            int nx = x + offset[0];
+            int ny = y + offset[1];
+            int nz = z + offset[2];
+            if (!board.inBounds(nx, ny, nz) || !board.occupied(nx, ny, nz))
+            {
+                continue;
+            }
+            int seed = board.cellIndex(nx, ny, nz);
+            if (scratch.visited[std::size_t(seed)] != scratch.stamp &&
+                !floodFill(board, scratch, seed, ++label, result.visited))
+            {
+                scratch.groupStart.push_back(int(scratch.cells.size()));
+            }
+        }
+    }
+
+    result.groups = int(scratch.groupStart.size()) - 1;
+    result.cells = int(scratch.cells.size());
+    if (result.groups == 0)
+    {
+        return result;
+    }
+
+    // Lift every hanging group off the board, and then lower them all together a layer at a time. A group lands, and
+    // goes back on the board, as soon as anything is below it, which may be a group which landed on the same layer.
+    scratch.colors.resize(scratch.cells.size());
+    for (std::size_t i = 0; i < scratch.cells.size(); i++)
+    {
+        board.cellCoords(scratch.cells[i], x, y, z);
+        scratch.colors[i] = uint8_t(board.color(x, y, z));
+        board.set(x, y, z, 0);
+    }
+    scratch.landed.assign(std::size_t(result.groups), false);
+    int falling = result.groups;
+    for (int fallen = 0; falling > 0; fallen++)
+    {
+        bool landedAny = true;
+        while (landedAny)
+        {
+            landedAny = false;
+            for (int group = 0; group < result.groups; group++)
+            {
+                if (scratch.landed[std::size_t(group)] || canFall(board, scratch, group, fallen))
+                {
+                    continue;
+                }
+                for (int i = scratch.groupStart[std::size_t(group)]; i < scratch.groupStart[std::size_t(group) + 1];
+                     i++)
+                {
+                    board.cellCoords(scratch.cells[std::size_t(i)], x, y, z);
+                    board.set(x, y - fallen, z, scratch.colors[std::size_t(i)]);
+                }
+                scratch.landed[std::size_t(group)] = true;
+                result.distance = std::max(result.distance, fallen);
+                landedAny = true;
+                falling--;
+            }
+        }
+    }
+    return result;
+}
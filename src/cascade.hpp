@@ -0,0 +1,22 @@
+#pragma once
+
+#include "board.hpp"
+#include "lineClear.hpp"
+
+// Outcome of a call to clearLinesCascade.
+struct CascadeResult
+{
+    // Groups of cells left hanging by the clear, which fell, and how many cells they held.
+    int groups = 0;
+    int cells = 0;
+    // Furthest any group fell, in layers.
+    int distance = 0;
+    // Cells looked at by the flood fill.
+    int visited = 0;
+};
+
+// Removes the given lines without compacting the columns, and then drops every group of cells connected through their
+// faces which no longer rests on the floor, as a rigid body, until it lands on something. Only the groups touching a
+// removed cell are searched, and the search of each stops as soon as it reaches the floor or a group already known to
+// rest on it, so the cost depends on what was cleared and not on the size of the board.
+CascadeResult clearLinesCascade(Board& board, const LineClearResult& lines);
@@ -1,6 +1,8 @@
 #include "cube.hpp"
 
 #include "gameLogic.hpp"
+#include "log.hpp"
+#include "profiler.hpp"
 #include "utils.hpp"
 
 #include <cubos/core/ecs/reflection.hpp>
@@ -12,22 +14,101 @@
 #include <cubos/engine/transform/plugin.hpp>
 #include <cubos/engine/utils/free_camera/controller.hpp>
 
+#include <utility>
+#include <vector>
+
 using namespace cubos::engine;
 
 CUBOS_REFLECT_IMPL(Cube)
 {
     return cubos::core::ecs::TypeBuilder<Cube>("Obstacle")
         .withField("trackingIndex", &Cube::trackingIndex)
+        .withField("board", &Cube::board)
+        .build();
+}
+
+CUBOS_REFLECT_IMPL(GhostCube)
+{
+    return cubos::core::ecs::TypeBuilder<GhostCube>("GhostCube")
+        .withField("trackingIndex", &GhostCube::trackingIndex)
+        .withField("board", &GhostCube::board)
         .build();
 }
 
 CUBOS_REFLECT_IMPL(StationaryCube)
 {
     return cubos::core::ecs::TypeBuilder<StationaryCube>("StationaryCube")
-        .withField("gen", &StationaryCube::gen)
+        .withField("cell", &StationaryCube::cell)
+        .withField("board", &StationaryCube::board)
         .build();
 }
 
+CUBOS_REFLECT_IMPL(BoardCubes)
+{
+    return cubos::core::ecs::TypeBuilder<BoardCubes>("BoardCubes").build();
+}
+
+CUBOS_REFLECT_IMPL(FallingCubes)
+{
+    return cubos::core::ecs::TypeBuilder<FallingCubes>("FallingCubes").build();
+}
+
+// Places the cubes of a board's floating piece and its ghost, if the piece changed or is gliding into its cell.
+static void trackFallingBlock(Commands& cmds, const GameBoard& board, const Game& game, FallingCubes& falling,
+                              PlayerInput& input)
+{
+    if (falling.cubes.empty())
+    {
+        return;
+    }
+
+    float lift = 0.0F;
+    bool moveCubes = falling.stale;
+    if (falling.glideTick != -1)
+    {
+        if (falling.glideTick == game.tick && game.floatingPieceColor != 0)
+        {
+            lift = CUBE_SCALE * (1.0F - tickAlpha(game));
+        }
+        else
+        {
+            falling.glideTick = -1;
+        }
+        moveCubes = true;
+    }
+    if (!moveCubes)
+    {
+        return;
+    }
+
+    int drop = dropDistance(game);
+    for (int i = 0; i < PIECE_BLOCKS; i++)
+    {
+        Position cube{PARKED_POS};
+        Position ghost{PARKED_POS};
+        if (game.floatingPieceColor != 0)
+        {
+            cube.vec = board.origin + gridToWorld(game.board, game.blockX[i], game.blockY[i], game.blockZ[i]) +
+                       glm::vec3(0.0F, lift, 0.0F);
+            ghost.vec = board.origin + gridToWorld(game.board, game.blockX[i], game.blockY[i] - drop, game.blockZ[i]) +
+                        GHOST_OFFSET;
+        }
+        cmds.add(falling.cubes[i], cube);
+        if (falling.stale)
+        {
+            cmds.add(falling.ghosts[i], ghost);
+        }
+    }
+
+    // Shows up in the game timings as the time from the input to the frame which first shows its effect.
+    if (falling.stale && input.unshown)
+    {
+        Profiler::instance().record("input latency", *input.unshown, Profiler::Clock::now());
+        input.unshown.reset();
+    }
+    falling.stale = false;
+}
+
 void cubePlugin(Cubos& cubos)
 {
     cubos.depends(assetsPlugin);
@@ -35,23 +116,58 @@ void cubePlugin(Cubos& cubos)
     cubos.depends(gameLogicPlugin);
 
     cubos.component<Cube>();
+    cubos.component<GhostCube>();
     cubos.component<StationaryCube>();
+    cubos.component<BoardCubes>();
+    cubos.component<FallingCubes>();
 
+    cubos.observer("add cubes to new boards").onAdd<GameBoard>().call([](Commands cmds, Query<Entity> boards) {
+        for (auto [board] : boards)
+        {
+            cmds.add(board, BoardCubes{});
+            cmds.add(board, FallingCubes{});
+        }
+    });
+
+    // Nothing here runs while the piece sits still between ticks. The ghost only moves with the piece, as the board
+    // under it can't change while there is one, and its landing spot comes from the column heights. A piece which
+    // fell on the last tick glides down from the cell above it until the next one.
     cubos.system("track falling block")
-        .call([](Commands cmds, const Game& game, Query<Entity, const Cube&, Position&> cubes) {
-            for (auto [ent, cube, position] : cubes)
+        .after(gameEventsTag)
+        .call([](Commands cmds, Query<const GameBoard&, const Game&, FallingCubes&, PlayerInput&> boards,
+                 EventReader<GameEvent> events) {
+            PROFILE_SCOPE("track falling block");
+
+            // Events find their board by its index, rather than by searching every board.
+            std::vector<std::pair<const Game*, FallingCubes*>> byIndex;
+            for (auto [board, game, falling, input] : boards)
+            {
+                if (std::size_t(board.index) >= byIndex.size())
+                {
+                    byIndex.resize(std::size_t(board.index) + 1, {nullptr, nullptr});
+                }
+                byIndex[std::size_t(board.index)] = {&game, &falling};
+            }
+
+            for (const auto& event : events)
             {
-                auto new_position = gridToWorld(
-                    game.blockX[cube.trackingIndex],
-                    game.blockY[cube.trackingIndex],
-                    game.blockZ[cube.trackingIndex]
-                );
-                if (position.vec == new_position)
+                GAME_TRACE("Game event {}", int(event.type));
+                if (event.index < 0 || std::size_t(event.index) >= byIndex.size() ||
+                    byIndex[std::size_t(event.index)].second == nullptr)
                 {
                     continue;
                 }
-                position.vec = new_position;
-                CUBOS_INFO("Updating cube {} to position {}, {}, {}", ent, position.vec.x, position.vec.y, position.vec.z);
+                auto [game, falling] = byIndex[std::size_t(event.index)];
+                falling->stale = true;
+                if (event.type == PIECE_FELL)
+                {
+                    falling->glideTick = game->tick;
+                }
+            }
+
+            for (auto [board, game, falling, input] : boards)
+            {
+                trackFallingBlock(cmds, board, game, falling, input);
             }
         });
 }
@@ -4,18 +4,65 @@
 
 #include <cubos/engine/prelude.hpp>
 
+#include <vector>
+
+// Every cube belongs to a board, which is the entity holding its Game, and is only ever moved by that board's systems.
 struct Cube
 {
     CUBOS_REFLECT;
 
     int trackingIndex = 0;
+    cubos::engine::Entity board{};
+};
+
+// One block of the ghost piece, which previews where the floating piece would land.
+struct GhostCube
+{
+    CUBOS_REFLECT;
+
+    int trackingIndex = 0;
+    cubos::engine::Entity board{};
 };
 
 struct StationaryCube
 {
     CUBOS_REFLECT;
 
-    int gen = 0;
+    // Index of the board cell this cube shows, or -1 if it is pooled.
+    int cell = -1;
+    cubos::engine::Entity board{};
+};
+
+// Maps each board cell to the entity showing it, and keeps the cubes of emptied cells around for reuse. Added to each
+// board when it is spawned, like FallingCubes.
+struct BoardCubes
+{
+    CUBOS_REFLECT;
+
+    std::vector<cubos::engine::Entity> cells{};
+    std::vector<cubos::engine::Entity> pool{};
+};
+
+// The cubes showing the floating piece and its ghost, one per block. They are spawned once and only moved when a piece
+// event says the piece changed, and parked while there is no piece.
+struct FallingCubes
+{
+    CUBOS_REFLECT;
+
+    std::vector<cubos::engine::Entity> cubes{};
+    std::vector<cubos::engine::Entity> ghosts{};
+
+    // Set when the cubes have to be placed even without a piece event, such as right after they were spawned.
+    bool stale = true;
+    // Tick on which the piece last fell, while it is still gliding into its cell, or -1.
+    int glideTick = -1;
 };
 
+// Where pooled cubes are parked while they are not showing any cell.
+const glm::vec3 PARKED_POS = glm::vec3(0.0f, -1000.0f, 0.0f);
+
+// Ghost cubes are drawn smaller than regular ones, centered on their cell.
+const float GHOST_SCALE = 0.05f;
+const glm::vec3 GHOST_OFFSET = glm::vec3(1.0f);
+
 void cubePlugin(cubos::engine::Cubos& cubos);
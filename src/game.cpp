@@ -0,0 +1,553 @@
+#include "game.hpp"
+
+#include "cascade.hpp"
+#include "log.hpp"
+#include "profiler.hpp"
+
+#include <cubos/core/ecs/reflection.hpp>
+#include <cubos/core/reflection/external/glm.hpp>
+#include <cubos/core/reflection/external/primitives.hpp>
+#include <cubos/core/reflection/external/string.hpp>
+#include <cubos/core/reflection/external/vector.hpp>
+
+#include <algorithm>
+
+CUBOS_REFLECT_IMPL(Game)
+{
+    return cubos::core::ecs::TypeBuilder<Game>("Game")
+        .withField("tickAccumulator", &Game::tickAccumulator)
+        .withField("tickPeriod", &Game::tickPeriod)
+        .withField("maxCatchUpTicks", &Game::maxCatchUpTicks)
+        .withField("board", &Game::board)
+        .withField("boardGen", &Game::boardGen)
+        .withField("floatingPieceColor", &Game::floatingPieceColor)
+        .withField("pieceType", &Game::pieceType)
+        .withField("pieceOrientation", &Game::pieceOrientation)
+        .withField("pieceX", &Game::pieceX)
+        .withField("pieceY", &Game::pieceY)
+        .withField("pieceZ", &Game::pieceZ)
+        .withField("blockX", &Game::blockX)
+        .withField("blockY", &Game::blockY)
+        .withField("blockZ", &Game::blockZ)
+        .withField("score", &Game::score)
+        .withField("clearAllAtOnce", &Game::clearAllAtOnce)
+        .withField("cascadeGravity", &Game::cascadeGravity)
+        .withField("gameOver", &Game::gameOver)
+        .withField("pieces", &Game::pieces)
+        .withField("lines", &Game::lines)
+        .withField("tick", &Game::tick)
+        .withField("seed", &Game::seed)
+        .withField("rngState", &Game::rngState)
+        .build();
+}
+
+void seedGame(Game& game, uint64_t seed)
+{
+    game.seed = seed;
+    game.rngState = seed;
+}
+
+void resetGame(Game& game, uint64_t seed)
+{
+    Game fresh;
+    fresh.tickPeriod = game.tickPeriod;
+    fresh.maxCatchUpTicks = game.maxCatchUpTicks;
+    fresh.ticksToLock = game.ticksToLock;
+    fresh.clearAllAtOnce = game.clearAllAtOnce;
+    fresh.cascadeGravity = game.cascadeGravity;
+    fresh.board = std::move(game.board);
+    fresh.board.clear();
+    fresh.boardGen = game.boardGen + 1;
+    fresh.events = PIECE_SPAWNED;
+    seedGame(fresh, seed);
+    game = std::move(fresh);
+}
+
+int advanceClock(Game& game, float dt)
+{
+    game.tickAccumulator += dt;
+    int owed = int(game.tickAccumulator / game.tickPeriod);
+    game.tickAccumulator -= float(owed) * game.tickPeriod;
+    if (owed > game.maxCatchUpTicks)
+    {
+        GAME_WARN("Logic fell {} ticks behind, skipping {}", owed, owed - game.maxCatchUpTicks);
+        owed = game.maxCatchUpTicks;
+    }
+    return owed;
+}
+
+float tickAlpha(const Game& game)
+{
+    return std::clamp(game.tickAccumulator / game.tickPeriod, 0.0F, 1.0F);
+}
+
+uint32_t nextRandom(Game& game)
+{
+    // SplitMix64: tiny state, cheap to copy along with the game, and good enough for picking pieces.
+    uint64_t z = (game.rngState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return uint32_t((z ^ (z >> 31)) >> 32);
+}
+
+bool isPositionValid(const Game& game, int x, int y, int z)
+{
+    return game.board.inBounds(x, y, z) && !game.board.occupied(x, y, z);
+}
+
+void spawnBlock(Game& game)
+{
+    GAME_DEBUG("Spawning new piece");
+
+    // Pick a random piece and color.
+    int pieceType = nextRandom(game) % PIECE_TYPES;
+    game.floatingPieceColor = (nextRandom(game) % 5) + 1; // Colors 1-5
+
+    const auto& shape = PIECE_SPAWN_SHAPES[pieceType];
+
+    // Clear the old floating piece data.
+    game.blockX.clear();
+    game.blockY.clear();
+    game.blockZ.clear();
+
+    // Set spawn position at top-center.
+    int startX = game.board.width / 2 - 1;
+    int startY = game.board.height - 2;
+    int startZ = game.board.depth / 2 - 1;
+
+    // The piece is tracked by its pivot and orientation, so that it can be rotated later.
+    const auto& pivot = shape[PIECE_PIVOTS[pieceType]];
+    game.pieceType = pieceType;
+    game.pieceOrientation = 0;
+    game.pieceX = startX + pivot.x;
+    game.pieceY = startY + pivot.y;
+    game.pieceZ = startZ + pivot.z;
+
+    // Create the new piece and check for game over.
+    for (const auto& block : shape)
+    {
+        int x = startX + block.x;
+        int y = startY + block.y;
+        int z = startZ + block.z;
+
+        if (!isPositionValid(game, x, y, z))
+        {
+            GAME_CRITICAL("GAME OVER: Cannot spawn new piece in an occupied space.");
+            game.floatingPieceColor = 0; // Prevent further movement
+            game.blockX.clear();
+            game.blockY.clear();
+            game.blockZ.clear();
+            game.gameOver = true;
+            game.events |= GAME_ENDED;
+            return;
+        }
+
+        game.blockX.push_back(x);
+        game.blockY.push_back(y);
+        game.blockZ.push_back(z);
+    }
+    game.pieces++;
+    game.events |= PIECE_SPAWNED;
+}
+
+// Returns true if the block could move down, false if it hit something
+bool moveBlockDown(Game& game)
+{
+    int numBlocks = game.blockX.size();
+    // Check if we can move down. There is nothing to move without a piece, such as right after a failed spawn.
+    if (numBlocks == 0 ||
+        !game.board.fits(game.blockX.data(), game.blockY.data(), game.blockZ.data(), numBlocks, 0, -1, 0))
+    {
+        return false;
+    }
+    GAME_TRACE("Moving block down to y = {}", game.blockY[0] - 1);
+    // Move down
+    for (int i = 0; i < numBlocks; i++)
+    {
+        game.blockY[i]--;
+    }
+    game.pieceY--;
+    game.events |= PIECE_FELL;
+    return true;
+}
+
+bool moveBlock(Game& game, Direction dir)
+{
+    int dx = 0;
+    int dz = 0;
+    switch (dir)
+    {
+    case NORTH:
+        dx = 1;
+        break;
+    case EAST:
+        dz = 1;
+        break;
+    case SOUTH:
+        dx = -1;
+        break;
+    case WEST:
+        dz = -1;
+        break;
+    }
+
+    int numBlocks = game.blockX.size();
+    // Check if we can move
+    if (!game.board.fits(game.blockX.data(), game.blockY.data(), game.blockZ.data(), numBlocks, dx, 0, dz))
+    {
+        return false;
+    }
+
+    // Move
+    for (int i = 0; i < numBlocks; i++)
+    {
+        game.blockX[i] += dx;
+        game.blockZ[i] += dz;
+    }
+    game.pieceX += dx;
+    game.pieceZ += dz;
+    game.events |= PIECE_MOVED;
+    return true;
+}
+
+bool pieceFits(const Board& board, int type, int orientation, int x, int y, int z)
+{
+    for (const auto& block : PIECES.orientations[type][orientation])
+    {
+        int bx = x + block.x;
+        int by = y + block.y;
+        int bz = z + block.z;
+        if (!board.inBounds(bx, by, bz) || board.occupied(bx, by, bz))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Shared by both versions of dropDistance, over the coordinates of each block.
+static int dropDistance(const Board& board, const int* xs, const int* ys, const int* zs, int count)
+{
+    int distance = board.height;
+    for (int i = 0; i < count; i++)
+    {
+        int gap = ys[i] - board.columnHeight(xs[i], zs[i]);
+        if (gap < 0)
+        {
+            // This block is below the top of its column, so the heights say nothing about what's under it.
+            distance = 0;
+            while (board.fits(xs, ys, zs, count, 0, -distance - 1, 0))
+            {
+                distance++;
+            }
+            return distance;
+        }
+        distance = std::min(distance, gap);
+    }
+    return distance;
+}
+
+int dropDistance(const Board& board, int type, int orientation, int x, int y, int z)
+{
+    int xs[PIECE_BLOCKS];
+    int ys[PIECE_BLOCKS];
+    int zs[PIECE_BLOCKS];
+    const auto& shape = PIECES.orientations[type][orientation];
+    for (int i = 0; i < PIECE_BLOCKS; i++)
+    {
+        xs[i] = x + shape[i].x;
+        ys[i] = y + shape[i].y;
+        zs[i] = z + shape[i].z;
+    }
+    return dropDistance(board, xs, ys, zs, PIECE_BLOCKS);
+}
+
+int dropDistance(const Game& game)
+{
+    if (game.floatingPieceColor == 0)
+    {
+        return 0;
+    }
+    return dropDistance(game.board, game.blockX.data(), game.blockY.data(), game.blockZ.data(),
+                        int(game.blockX.size()));
+}
+
+bool hardDrop(Game& game)
+{
+    if (game.floatingPieceColor == 0)
+    {
+        return false;
+    }
+
+    int distance = dropDistance(game);
+    GAME_TRACE("Hard dropping piece by {}", distance);
+    for (auto& y : game.blockY)
+    {
+        y -= distance;
+    }
+    game.pieceY -= distance;
+    game.events |= PIECE_MOVED;
+    lockFloatingBlock(game);
+    return true;
+}
+
+bool kickPiece(const Board& board, int type, int orientation, int& x, int& y, int& z)
+{
+    // Try each kick in order, and take the first one where the piece fits.
+    for (int k = 0; k < pieceKickCount(type); k++)
+    {
+        const auto& kick = PIECE_KICKS[k];
+        if (pieceFits(board, type, orientation, x + kick.x, y + kick.y, z + kick.z))
+        {
+            x += kick.x;
+            y += kick.y;
+            z += kick.z;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool rotateBlock(Game& game, Axis axis, bool clockwise)
+{
+    if (game.floatingPieceColor == 0)
+    {
+        return false;
+    }
+
+    int orientation = PIECES.rotations[game.pieceType][game.pieceOrientation][axis][clockwise ? 0 : 1];
+    int pivotX = game.pieceX;
+    int pivotY = game.pieceY;
+    int pivotZ = game.pieceZ;
+    if (!kickPiece(game.board, game.pieceType, orientation, pivotX, pivotY, pivotZ))
+    {
+        return false;
+    }
+
+    const auto& shape = PIECES.orientations[game.pieceType][orientation];
+    game.pieceOrientation = orientation;
+    game.pieceX = pivotX;
+    game.pieceY = pivotY;
+    game.pieceZ = pivotZ;
+    for (int i = 0; i < PIECE_BLOCKS; i++)
+    {
+        game.blockX[i] = pivotX + shape[i].x;
+        game.blockY[i] = pivotY + shape[i].y;
+        game.blockZ[i] = pivotZ + shape[i].z;
+    }
+    game.events |= PIECE_MOVED;
+    return true;
+}
+
+bool tryToClear(Game& game)
+{
+    LineClearResult lines = findFullLines(game.board);
+    if (lines.count == 0)
+    {
+        return false;
+    }
+
+    if (!game.clearAllAtOnce)
+    {
+        // Only clear one line per tick, so that clearing "animates".
+        lines = firstLine(lines);
+    }
+
+    GAME_INFO("Clearing {} lines", lines.count);
+    if (game.cascadeGravity)
+    {
+        CascadeResult fell = clearLinesCascade(game.board, lines);
+        if (fell.groups > 0)
+        {
+            GAME_DEBUG("{} groups of {} blocks fell up to {} layers", fell.groups, fell.cells, fell.distance);
+            game.events |= BLOCKS_FELL;
+        }
+    }
+    else
+    {
+        clearLines(game.board, lines);
+    }
+    game.lastClear = lines;
+    game.chain++;
+
+    game.score += 10 * lines.count; // Add points for each line
+    game.lines += lines.count;
+    game.boardGen++;
+    game.events |= LINES_CLEARED;
+    return true; // Lines were cleared, exit to process next tick.
+}
+
+void lockFloatingBlock(Game& game)
+{
+    int numBlocks = game.blockX.size();
+    for (int i = 0; i < numBlocks; i++)
+    {
+        int x = game.blockX[i];
+        int y = game.blockY[i];
+        int z = game.blockZ[i];
+
+        game.board.set(x, y, z, game.floatingPieceColor);
+    }
+
+    // Reset floating piece
+    game.floatingPieceColor = 0;
+    game.blockX.clear();
+    game.blockY.clear();
+    game.blockZ.clear();
+
+    // Reset tick lock accumulator
+    game.tickLockAccumulator = 0;
+    game.chain = 0;
+
+    game.boardGen++;
+    game.events |= PIECE_LOCKED;
+}
+
+bool applyAction(Game& game, Action action)
+{
+    switch (action)
+    {
+    case ACTION_MOVE_NORTH:
+        return moveBlock(game, NORTH);
+    case ACTION_MOVE_EAST:
+        return moveBlock(game, EAST);
+    case ACTION_MOVE_SOUTH:
+        return moveBlock(game, SOUTH);
+    case ACTION_MOVE_WEST:
+        return moveBlock(game, WEST);
+    case ACTION_ROTATE_X_CW:
+        return rotateBlock(game, AXIS_X, true);
+    case ACTION_ROTATE_X_CCW:
+        return rotateBlock(game, AXIS_X, false);
+    case ACTION_ROTATE_Y_CW:
+        return rotateBlock(game, AXIS_Y, true);
+    case ACTION_ROTATE_Y_CCW:
+        return rotateBlock(game, AXIS_Y, false);
+    case ACTION_ROTATE_Z_CW:
+        return rotateBlock(game, AXIS_Z, true);
+    case ACTION_ROTATE_Z_CCW:
+        return rotateBlock(game, AXIS_Z, false);
+    case ACTION_HARD_DROP:
+        return hardDrop(game);
+    default:
+        return false;
+    }
+}
+
+bool addGarbage(Game& game, int layers)
+{
+    Board& board = game.board;
+    layers = std::min(layers, board.height);
+    if (layers <= 0)
+    {
+        return true;
+    }
+
+    bool overflow = false;
+    for (int y = board.height - layers; y < board.height; y++)
+    {
+        for (int z = 0; z < board.depth; z++)
+        {
+            overflow = overflow || board.row(y, z) != 0;
+        }
+    }
+
+    // Top down, so that every cell is read before it is overwritten.
+    for (int y = board.height - 1; y >= layers; y--)
+    {
+        for (int z = 0; z < board.depth; z++)
+        {
+            if ((board.row(y, z) | board.row(y - layers, z)) == 0)
+            {
+                continue;
+            }
+            for (int x = 0; x < board.width; x++)
+            {
+                board.set(x, y, z, board.color(x, y - layers, z));
+            }
+        }
+    }
+
+    for (int y = 0; y < layers; y++)
+    {
+        int offset = int(nextRandom(game) % uint32_t(board.width));
+        for (int z = 0; z < board.depth; z++)
+        {
+            for (int x = 0; x < board.width; x++)
+            {
+                bool hole = x == (z + offset) % board.width || z == (x + offset) % board.depth;
+                board.set(x, y, z, hole ? 0 : GARBAGE_COLOR);
+            }
+        }
+    }
+
+    game.boardGen++;
+    game.events |= GARBAGE_ADDED;
+    if (overflow)
+    {
+        GAME_INFO("GAME OVER: Garbage pushed the board out of the top.");
+        game.gameOver = true;
+        game.events |= GAME_ENDED;
+        return false;
+    }
+    return true;
+}
+
+void tickGame(Game& game)
+{
+    if (game.gameOver)
+    {
+        return;
+    }
+    game.tick++;
+
+    // If there is no block,
+    if (game.floatingPieceColor == 0)
+    {
+        // If there is no block, a block was just locked in place, so try to clear lines
+        bool cleared;
+        {
+            PROFILE_SCOPE("logic: clear");
+            cleared = tryToClear(game);
+        }
+        if (!cleared)
+        {
+            // If nothing to clear, spawn a new block
+            PROFILE_SCOPE("logic: spawn");
+            spawnBlock(game);
+            if (game.gameOver)
+            {
+                return;
+            }
+            // This makes it so we do each step of clearing on a separate tick, so it "animates" the clearing
+        } else
+        {
+            // If we cleared something, don't do the rest of the tick logic yet
+            return;
+        }
+    }
+
+    bool movedDown;
+    {
+        PROFILE_SCOPE("logic: move down");
+        movedDown = moveBlockDown(game);
+    }
+    if (!movedDown)
+    {
+        GAME_TRACE("Block cannot move down further.");
+
+        if (game.tickLockAccumulator < game.ticksToLock)
+        {
+            game.tickLockAccumulator++;
+            GAME_TRACE("Tick lock accumulator: {}", game.tickLockAccumulator);
+        } else
+        {
+            GAME_DEBUG("Tick lock released, locking block in place.");
+            PROFILE_SCOPE("logic: lock");
+            lockFloatingBlock(game);
+        }
+    } else
+    {
+        game.tickLockAccumulator = 0; // reset if we moved down, in case we adjust the block after landing
+    }
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cubos/core/reflection/reflect.hpp>
+
+#include "board.hpp"
+#include "lineClear.hpp"
+#include "pieces.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Things which happen to the game, as bits of Game::events. PIECE_SPAWNED is also used when the whole game is
+// replaced, such as when it is restarted or loaded.
+enum GameEventType
+{
+    PIECE_LOCKED = 1 << 0,
+    PIECE_SPAWNED = 1 << 1,
+    PIECE_MOVED = 1 << 2,
+    // Moved down a cell by gravity, as opposed to by the player.
+    PIECE_FELL = 1 << 3,
+    LINES_CLEARED = 1 << 4,
+    GAME_ENDED = 1 << 5,
+    // Garbage layers were pushed in under the board by an opponent.
+    GARBAGE_ADDED = 1 << 6,
+    // Blocks left hanging by a clear fell, with cascade gravity.
+    BLOCKS_FELL = 1 << 7,
+};
+
+// Color of the cells of garbage layers, which no piece uses.
+const int GARBAGE_COLOR = 6;
+
+struct Game
+{
+    CUBOS_REFLECT;
+
+    float tickAccumulator = 0.0F;
+    float tickPeriod = 0.3F;
+    // Most ticks run to catch up in a single frame. Time owed beyond that is dropped.
+    int maxCatchUpTicks = 4;
+
+    int ticksToLock = 3;
+    int tickLockAccumulator = 0;
+
+    // Number of logic ticks run so far.
+    int tick = 0;
+
+    // Every random choice is drawn from this generator, so a game is fully determined by its seed and inputs.
+    uint64_t seed = 0;
+    uint64_t rngState = 0;
+
+    Board board{};
+    int boardGen = 0;
+
+    // Sparse floating piece
+    int floatingPieceColor = 0;
+
+    // Type, orientation and pivot position of the floating piece, which its blocks are derived from.
+    int pieceType = 0;
+    int pieceOrientation = 0;
+    int pieceX = 0;
+    int pieceY = 0;
+    int pieceZ = 0;
+
+    // Coordinates of each block.
+    std::vector<int> blockX{};
+    std::vector<int> blockY{};
+    std::vector<int> blockZ{};
+
+    int score = 0;
+    bool gameOver = false;
+
+    // Totals since the game started.
+    int pieces = 0;
+    int lines = 0;
+
+    // If set, every full line is cleared on the same tick, instead of one line per tick.
+    bool clearAllAtOnce = false;
+    // If set, cleared lines leave everything else in place, and then every group of blocks they left hanging falls as
+    // a whole, which may complete more lines. Otherwise each column above a cleared line moves down.
+    bool cascadeGravity = false;
+    // Lines removed by the last clear, for presentation.
+    LineClearResult lastClear{};
+    // Clears since the last piece locked, for presentation. Above one when falling blocks completed more lines, or when
+    // lines are cleared one at a time.
+    int chain = 0;
+    // Every GameEventType which happened since whoever presents the game last reset this. Kept as a mask, so that it
+    // stays bounded in headless runs where nobody does.
+    int events = 0;
+};
+
+// North is +x, East is +z
+enum Direction { NORTH, EAST, SOUTH, WEST };
+
+// Inputs which can be applied to a game, in terms of world directions.
+enum Action
+{
+    ACTION_MOVE_NORTH,
+    ACTION_MOVE_EAST,
+    ACTION_MOVE_SOUTH,
+    ACTION_MOVE_WEST,
+    ACTION_ROTATE_X_CW,
+    ACTION_ROTATE_X_CCW,
+    ACTION_ROTATE_Y_CW,
+    ACTION_ROTATE_Y_CCW,
+    ACTION_ROTATE_Z_CW,
+    ACTION_ROTATE_Z_CCW,
+    ACTION_HARD_DROP,
+    ACTION_COUNT
+};
+
+inline Action moveAction(Direction dir)
+{
+    return Action(int(ACTION_MOVE_NORTH) + int(dir));
+}
+
+// Quarter turn around the horizontal axis pointing in the given direction, clockwise when looking down the axis.
+inline Action rotateAction(Direction axis)
+{
+    switch (axis)
+    {
+    case NORTH:
+        return ACTION_ROTATE_X_CW;
+    case SOUTH:
+        return ACTION_ROTATE_X_CCW;
+    case EAST:
+        return ACTION_ROTATE_Z_CW;
+    default:
+        return ACTION_ROTATE_Z_CCW;
+    }
+}
+
+void seedGame(Game& game, uint64_t seed);
+// Starts a new game with the given seed, keeping the board size and the settings of the current one. Only the cells
+// which were filled are touched, and they are marked dirty, so whatever mirrors the board can recycle their cubes.
+void resetGame(Game& game, uint64_t seed);
+
+// Adds dt seconds to the tick accumulator and takes out every whole tick period in it. Returns how many ticks to run,
+// which is at most maxCatchUpTicks, so that after a long hitch the game skips ahead instead of spending the following
+// frames catching up and falling further behind.
+int advanceClock(Game& game, float dt);
+// How far the game is from its last tick to the next one, from 0 to 1.
+float tickAlpha(const Game& game);
+uint32_t nextRandom(Game& game);
+
+bool isPositionValid(const Game& game, int x, int y, int z);
+void spawnBlock(Game& game);
+// Returns true if the block could move down, false if it hit something
+bool moveBlockDown(Game& game);
+bool moveBlock(Game& game, Direction dir);
+// Checks if a piece with the given type and orientation fits on the board with its pivot at (x, y, z).
+bool pieceFits(const Board& board, int type, int orientation, int x, int y, int z);
+// Moves the pivot by the first kick which makes the piece fit. Returns false, leaving the pivot alone, if none does.
+bool kickPiece(const Board& board, int type, int orientation, int& x, int& y, int& z);
+// Number of cells a piece can fall before it lands. Four column height lookups when the piece is above everything it
+// covers, which is almost always, and a cell by cell check otherwise, such as when it was slid under an overhang.
+int dropDistance(const Board& board, int type, int orientation, int x, int y, int z);
+// Same as above, for the floating piece. Returns 0 if there is none.
+int dropDistance(const Game& game);
+// Drops the floating piece straight to its landing spot and locks it there. Returns false if there is no piece.
+bool hardDrop(Game& game);
+// Turns the floating piece a quarter turn around its pivot, kicking it away from obstacles if needed.
+bool rotateBlock(Game& game, Axis axis, bool clockwise);
+// Returns true if any line was cleared. With cascade gravity, the blocks the clear left hanging fall on the same tick,
+// so that each link of a chain takes a tick.
+bool tryToClear(Game& game);
+void lockFloatingBlock(Game& game);
+// Returns true if the action changed the game
+bool applyAction(Game& game, Action action);
+
+// Pushes everything on the board up by the given number of layers, and fills the layers left at the bottom with
+// garbage. Each garbage layer has a diagonal of holes, picked from the game's generator, so that no line in it is full
+// and it has to be dug out. Only call this while there is no floating piece. Ends the game, returning false, if any
+// cell is pushed out of the top.
+bool addGarbage(Game& game, int layers);
+
+// Runs a single logic tick: clears lines, spawns, moves the floating piece down and locks it.
+void tickGame(Game& game);
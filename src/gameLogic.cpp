@@ -1,331 +1,333 @@
 #include "gameLogic.hpp"
 
+#include "log.hpp"
+#include "profiler.hpp"
+#include "utils.hpp"
+
 #include <cubos/core/ecs/reflection.hpp>
 #include <cubos/core/reflection/external/glm.hpp>
 #include <cubos/core/reflection/external/primitives.hpp>
 #include <cubos/core/reflection/external/string.hpp>
-#include <cubos/core/reflection/external/vector.hpp>
 
-#include <cubos/core/tel/logging.hpp>
-#include <cubos/engine/assets/plugin.hpp>
-#include <cubos/engine/transform/plugin.hpp>
+#include <cubos/engine/prelude.hpp>
+#include <cubos/engine/settings/plugin.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <vector>
 
 using namespace cubos::engine;
 
-CUBOS_REFLECT_IMPL(Game)
+CUBOS_DEFINE_TAG(gameLogicTag);
+CUBOS_DEFINE_TAG(gameEventsTag);
+
+CUBOS_REFLECT_IMPL(GameBoard)
 {
-    return cubos::core::ecs::TypeBuilder<Game>("Game")
-        .withField("tickAccumulator", &Game::tickAccumulator)
-        .withField("tickPeriod", &Game::tickPeriod)
-        .withField("board", &Game::board)
-        .withField("boardGen", &Game::boardGen)
-        .withField("floatingPieceColor", &Game::floatingPieceColor)
-        .withField("blockX", &Game::blockX)
-        .withField("blockY", &Game::blockY)
-        .withField("blockZ", &Game::blockZ)
-        .withField("score", &Game::score)
+    return cubos::core::ecs::TypeBuilder<GameBoard>("GameBoard")
+        .withField("index", &GameBoard::index)
+        .withField("local", &GameBoard::local)
+        .withField("origin", &GameBoard::origin)
         .build();
 }
 
-bool isPositionValid(const Game& game, int x, int y, int z)
+CUBOS_REFLECT_IMPL(GameRecorder)
 {
-    if (x < 0 || x >= 10 || y < 0 || y >= 20 || z < 0 || z >= 10)
-    {
-        return false;
-    }
-    if (game.board[x][y][z] != 0)
-    {
-        return false;
-    }
-    return true;
+    return cubos::core::ecs::TypeBuilder<GameRecorder>("GameRecorder")
+        .withField("recordPath", &GameRecorder::recordPath)
+        .withField("playPath", &GameRecorder::playPath)
+        .withField("replaySpeed", &GameRecorder::replaySpeed)
+        .build();
 }
 
-void spawnBlock(Game& game)
+CUBOS_REFLECT_IMPL(GameHistory)
 {
-    CUBOS_INFO("Spawning new piece");
-
-    // Define the shapes of the pieces using relative coordinates from a pivot point.
-    // Each inner vector is {dx, dy, dz}. dy is always 0 for a flat spawn.
-    const std::vector<std::vector<std::vector<int>>> pieceShapes = {
-        // I-piece (Line)
-        {{0, 0, 0}, {0, 0, 1}, {0, 0, 2}, {0, 0, 3}},
-        // O-piece (Square)
-        {{0, 0, 0}, {1, 0, 0}, {0, 0, 1}, {1, 0, 1}},
-        // T-piece
-        {{0, 0, 0}, {1, 0, 0}, {2, 0, 0}, {1, 0, -1}},
-        // L-piece
-        {{0, 0, 0}, {0, 0, 1}, {0, 0, 2}, {1, 0, 2}},
-        // J-piece (Reversed L)
-        {{1, 0, 0}, {1, 0, 1}, {1, 0, 2}, {0, 0, 2}},
-        // S-piece
-        {{1, 0, 0}, {2, 0, 0}, {0, 0, 1}, {1, 0, 1}},
-        // Z-piece (Reversed S)
-        {{0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {2, 0, 1}}};
-
-    // Pick a random piece and color.
-    int pieceType = rand() % pieceShapes.size();
-    game.floatingPieceColor = (rand() % 5) + 1; // Colors 1-5
-
-    const auto& shape = pieceShapes[pieceType];
-
-    // Clear the old floating piece data.
-    game.blockX.clear();
-    game.blockY.clear();
-    game.blockZ.clear();
-
-    // Set spawn position at top-center.
-    int startX = 4;
-    int startY = 18;
-    int startZ = 4;
-
-    // Create the new piece and check for game over.
-    for (const auto& block : shape)
-    {
-        int x = startX + block[0];
-        int y = startY + block[1];
-        int z = startZ + block[2];
+    return cubos::core::ecs::TypeBuilder<GameHistory>("GameHistory").withField("paused", &GameHistory::paused).build();
+}
 
-        if (!isPositionValid(game, x, y, z))
-        {
-            CUBOS_CRITICAL("GAME OVER: Cannot spawn new piece in an occupied space.");
-            // Here you could implement a proper game over state.
-            // For now, we just stop spawning.
-            game.floatingPieceColor = 0; // Prevent further movement
-            return;
-        }
+CUBOS_REFLECT_IMPL(PlayerInput)
+{
+    return cubos::core::ecs::TypeBuilder<PlayerInput>("PlayerInput").build();
+}
 
-        game.blockX.push_back(x);
-        game.blockY.push_back(y);
-        game.blockZ.push_back(z);
-    }
+CUBOS_REFLECT_IMPL(Autoplay)
+{
+    return cubos::core::ecs::TypeBuilder<Autoplay>("Autoplay").withField("enabled", &Autoplay::enabled).build();
 }
 
-// Returns true if the block could move down, false if it hit something
-bool moveBlockDown(Game& game)
+bool playerAction(Game& game, GameRecorder& recorder, Action action)
 {
-    int numBlocks = game.blockX.size();
-    for (int i = 0; i < numBlocks; i++)
+    bool changed = applyAction(game, action);
+    if (recorder.isRecording())
     {
-        int x = game.blockX[i];
-        int y = game.blockY[i];
-        int z = game.blockZ[i];
+        recordInput(recorder.recording, game, action);
+    }
+    return changed;
+}
 
-        // Check if we can move down
-        if (y == 0 || game.board[x][y - 1][z] != 0)
-        {
-            return false;
-        }
+uint64_t gameSeed(Settings& settings)
+{
+    int seed = settings.getInteger("game.seed", 0);
+    return seed != 0 ? uint64_t(seed) : uint64_t(std::chrono::system_clock::now().time_since_epoch().count());
+}
+
+void restartGame(Game& game, GameRecorder& recorder, GameHistory& history, PlayerInput& input, Autoplay& autoplay,
+                 uint64_t seed)
+{
+    if (recorder.isReplaying())
+    {
+        recorder.replay.next = 0;
+        seed = recorder.recording.seed;
     }
-    CUBOS_INFO("Moving block down to y = {}", game.blockY[0] - 1);
-    // Move down
-    for (int i = 0; i < numBlocks; i++)
+    else
     {
-        game.blockY[i]--;
+        recorder.recording.inputs.clear();
+        recorder.recording.seed = seed;
+        recorder.saved = false;
     }
-    return true;
+    resetGame(game, seed);
+
+    clearRewind(history.buffer);
+    history.paused = false;
+    input.queue.clear();
+    input.unshown.reset();
+    autoplay.bot.plannedPiece = -1;
+    GAME_INFO("Restarted with seed {}", game.seed);
 }
 
-bool moveBlock(Game& game, Direction dir)
+bool showHistoryTick(GameHistory& history, Game& game, int tick)
 {
-    int dx = 0;
-    int dz = 0;
-    switch (dir)
+    if (!rewindTo(history.buffer, tick, game))
     {
-    case NORTH:
-        dx = 1;
-        break;
-    case EAST:
-        dz = 1;
-        break;
-    case SOUTH:
-        dx = -1;
-        break;
-    case WEST:
-        dz = -1;
-        break;
+        return false;
     }
+    history.paused = true;
+    return true;
+}
 
-    int numBlocks = game.blockX.size();
-    // Check if we can move
-    for (int i = 0; i < numBlocks; i++)
-    {
-        int x = game.blockX[i];
-        int y = game.blockY[i];
-        int z = game.blockZ[i];
+void resumeFromHistory(GameHistory& history, const Game& game, GameRecorder& recorder, Autoplay& autoplay)
+{
+    history.paused = false;
+    autoplay.bot.plannedPiece = -1;
+
+    // Inputs stamped with the shown tick were applied after it, so they go too.
+    auto& inputs = recorder.recording.inputs;
+    inputs.erase(std::find_if(inputs.begin(), inputs.end(),
+                              [&](const RecordedInput& input) { return input.tick >= uint32_t(game.tick); }),
+                 inputs.end());
+}
 
-        if (!isPositionValid(game, x + dx, y, z + dz))
+// Applies the queued actions made up to the given time, oldest first.
+static void applyQueued(Game& game, GameRecorder& recorder, PlayerInput& input, std::size_t& next,
+                        InputClock::time_point until)
+{
+    for (; next < input.queue.size() && input.queue[next].time <= until; next++)
+    {
+        if (playerAction(game, recorder, input.queue[next].action) && !input.unshown)
         {
-            return false;
+            input.unshown = input.queue[next].time;
         }
     }
+}
 
-    // Move
-    for (int i = 0; i < numBlocks; i++)
+// Runs the logic step of a single board. Touches nothing but the board's own components, so that boards can step in
+// parallel.
+static void stepBoard(float dt, InputClock::time_point now, Game& game, GameRecorder& recorder, PlayerInput& input,
+                      GameHistory& history, Autoplay& autoplay)
+{
+    // Run every tick owed since the last frame, so that the game keeps pace with the clock at any frame rate. The
+    // ticks are spread over the frame as they would have been on time, and each queued action is applied between the
+    // ticks it was made between.
+    int ticks = advanceClock(game, dt);
+    auto period = inputSeconds(game.tickPeriod);
+    auto tickTime = now - inputSeconds(game.tickAccumulator) - (ticks - 1) * period;
+    std::size_t next = 0;
+    if (recorder.isReplaying() || history.paused)
     {
-        game.blockX[i] += dx;
-        game.blockZ[i] += dz;
+        // The recording drives the game instead of the player, and nothing happens while paused.
+        input.queue.clear();
+    }
+    if (history.paused)
+    {
+        ticks = 0;
     }
-    return true;
-}
 
-bool tryToClear(Game& game)
-{
-    // --- Scan for and clear one complete X-line ---
-    for (int y = 0; y < 20; ++y)
+    for (; ticks > 0; ticks--, tickTime += period)
     {
-        for (int z = 0; z < 10; ++z)
+        if (!recorder.isReplaying())
         {
-            bool lineIsFull = true;
-            for (int x = 0; x < 10; ++x)
+            applyQueued(game, recorder, input, next, tickTime);
+
+            // The whole path to the chosen placement is applied as soon as the piece spawns.
+            if (autoplay.enabled && botPlan(autoplay.bot, game, &ThreadPool::shared(), autoplay.plan))
             {
-                if (game.board[x][y][z] == 0)
+                for (Action action : autoplay.plan.actions)
                 {
-                    lineIsFull = false;
-                    break;
+                    playerAction(game, recorder, action);
                 }
             }
 
-            if (lineIsFull)
+            int tick = game.tick;
+            tickGame(game);
+            if (game.tick != tick)
             {
-                CUBOS_INFO("Clearing X-line at y={}, z={}", y, z);
-                // Shift the slice above this line down.
-                for (int shiftY = y; shiftY < 19; ++shiftY)
-                {
-                    for (int x = 0; x < 10; ++x)
-                    {
-                        game.board[x][shiftY][z] = game.board[x][shiftY + 1][z];
-                    }
-                }
-                // Clear the top-most line of the slice.
-                for (int x = 0; x < 10; ++x)
-                {
-                    game.board[x][19][z] = 0;
-                }
-
-                game.score += 10; // Add points for one line
-                game.boardGen++;
-                return true; // A line was cleared, exit to process next tick.
+                recordRewind(history.buffer, game);
             }
         }
-    }
-
-    // --- Scan for and clear one complete Z-line ---
-    for (int y = 0; y < 20; ++y)
-    {
-        for (int x = 0; x < 10; ++x)
+        else if (recorder.replaySpeed <= 0)
         {
-            bool lineIsFull = true;
-            for (int z = 0; z < 10; ++z)
+            while (!recorder.replay.finished(recorder.recording) && !game.gameOver)
             {
-                if (game.board[x][y][z] == 0)
-                {
-                    lineIsFull = false;
-                    break;
-                }
+                stepReplay(recorder.replay, recorder.recording, game);
             }
-
-            if (lineIsFull)
+        }
+        else
+        {
+            for (int i = 0; i < recorder.replaySpeed; i++)
             {
-                CUBOS_INFO("Clearing Z-line at y={}, x={}", y, x);
-                // Shift the slice above this line down.
-                for (int shiftY = y; shiftY < 19; ++shiftY)
-                {
-                    for (int z = 0; z < 10; ++z)
-                    {
-                        game.board[x][shiftY][z] = game.board[x][shiftY + 1][z];
-                    }
-                }
-                // Clear the top-most line of the slice.
-                for (int z = 0; z < 10; ++z)
-                {
-                    game.board[x][19][z] = 0;
-                }
-
-                game.score += 10; // Add points for one line
-                game.boardGen++;
-                return true; // A line was cleared, exit to process next tick.
+                stepReplay(recorder.replay, recorder.recording, game);
             }
         }
     }
+    applyQueued(game, recorder, input, next, now);
+    input.queue.clear();
 
-    // No complete lines were found in the entire board.
-    return false;
-}
-
-void lockFloatingBlock(Game& game)
-{
-    int numBlocks = game.blockX.size();
-    for (int i = 0; i < numBlocks; i++)
+    if (game.gameOver && recorder.isRecording() && !recorder.saved)
     {
-        int x = game.blockX[i];
-        int y = game.blockY[i];
-        int z = game.blockZ[i];
-
-        game.board[x][y][z] = game.floatingPieceColor;
+        recorder.saved = saveRecording(recorder.recording, recorder.recordPath);
+        GAME_INFO("Saved {} inputs to {}", recorder.recording.inputs.size(), recorder.recordPath);
     }
-
-    // Reset floating piece
-    game.floatingPieceColor = 0;
-    game.blockX.clear();
-    game.blockY.clear();
-    game.blockZ.clear();
-
-    // Reset tick lock accumulator
-    game.tickLockAccumulator = 0;
-
-    game.boardGen++;
 }
 
 void gameLogicPlugin(Cubos& cubos)
 {
-    cubos.resource<Game>();
-
-    cubos.system("game logic")
-        .call([](Commands cmds, const DeltaTime& dt, Game& game) {
-            // Accumulate time
-            game.tickAccumulator += dt.value();
-            if (game.tickAccumulator < game.tickPeriod)
+    cubos.depends(settingsPlugin);
+
+    cubos.component<GameBoard>();
+    cubos.component<Game>();
+    cubos.component<GameRecorder>();
+    cubos.component<PlayerInput>();
+    cubos.component<GameHistory>();
+    cubos.component<Autoplay>();
+    cubos.event<GameEvent>();
+
+    cubos.tag(gameLogicTag);
+    cubos.tag(gameEventsTag).after(gameLogicTag);
+
+    // The "game.boards" setting picks how many boards to spawn. The first is played from the keyboard, and the rest
+    // by the bot, each with the next seed after the one before.
+    cubos.startupSystem("spawn the boards").after(settingsTag).call([](Commands cmds, Settings& settings) {
+        int count = std::max(1, settings.getInteger("game.boards", 1));
+        uint64_t seed = gameSeed(settings);
+        for (int index = 0; index < count; index++)
+        {
+            GameBoard board{.index = index, .local = index == 0};
+            Game game;
+            GameRecorder recorder;
+            PlayerInput input;
+            GameHistory history;
+            Autoplay autoplay;
+            autoplay.enabled = !board.local || settings.getBool("game.autoplay", false);
+            input.repeat.das = float(settings.getDouble("input.das", input.repeat.das));
+            input.repeat.arr = float(settings.getDouble("input.arr", input.repeat.arr));
+            if (board.local)
             {
-                return;
+                recorder.recordPath = settings.getString("replay.record", "");
+                recorder.playPath = settings.getString("replay.play", "");
+                recorder.replaySpeed = settings.getInteger("replay.speed", 1);
             }
-            game.tickAccumulator -= game.tickPeriod;
-
 
-
-            // If there is no block,
-            if (game.floatingPieceColor == 0)
+            bool replaying = false;
+            if (recorder.isReplaying())
             {
-                // If there is no block, a block was just locked in place, so try to clear lines
-                if (!tryToClear(game))
+                if (loadRecording(recorder.playPath, recorder.recording))
                 {
-                    // If nothing to clear, spawn a new block
-                    spawnBlock(game);
-                    // This makes it so we do each step of clearing on a separate tick, so it "animates" the clearing
-                } else
+                    GAME_INFO("Replaying {} inputs from {}", recorder.recording.inputs.size(), recorder.playPath);
+                    startReplay(recorder.replay, recorder.recording, game);
+                    recorder.recordPath.clear();
+                    replaying = true;
+                }
+                else
                 {
-                    // If we cleared something, don't do the rest of the tick logic yet
-                    return;
+                    GAME_ERROR("Could not load replay {}", recorder.playPath);
+                    recorder.playPath.clear();
                 }
             }
 
-            if (!moveBlockDown(game))
+            // Replays above pick the board size and rules of their recording.
+            if (!replaying)
             {
-                CUBOS_INFO("Block cannot move down further.");
-
-                if (game.tickLockAccumulator < game.ticksToLock)
-                {
-                    game.tickLockAccumulator++;
-                    CUBOS_INFO("Tick lock accumulator: {}", game.tickLockAccumulator);
-                } else
+                std::string size = settings.getString("board.size", "classic");
+                BoardPreset preset = BOARD_CLASSIC;
+                if (!parseBoardPreset(size.c_str(), preset))
                 {
-                    CUBOS_INFO("Tick lock released, locking block in place.");
-                    lockFloatingBlock(game);
+                    GAME_ERROR("Unknown board size {}, expected small, classic or huge", size);
                 }
-            } else
+                game.board = Board(preset);
+                game.cascadeGravity = settings.getBool("game.cascade", false);
+
+                seedGame(game, seed + uint64_t(index));
+                startRecording(recorder.recording, game);
+                GAME_INFO("Board {} seed is {}", index, game.seed);
+            }
+
+            double seconds = settings.getDouble("rewind.seconds", 30.0);
+            resetRewind(history.buffer, int(seconds / double(game.tickPeriod)));
+            board.origin = boardOrigin(game.board, index);
+
+            cmds.create()
+                .add(std::move(board))
+                .add(std::move(game))
+                .add(std::move(recorder))
+                .add(std::move(input))
+                .add(std::move(history))
+                .add(std::move(autoplay));
+        }
+    });
+
+    // Each board only touches its own components, so they step in parallel, with the calling thread taking part.
+    cubos.system("game logic")
+        .tagged(gameLogicTag)
+        .call([](const DeltaTime& dt, Query<Game&, GameRecorder&, PlayerInput&, GameHistory&, Autoplay&> boards) {
+            PROFILE_SCOPE("game logic");
+
+            std::vector<std::tuple<Game*, GameRecorder*, PlayerInput*, GameHistory*, Autoplay*>> steps;
+            for (auto [game, recorder, input, history, autoplay] : boards)
             {
-                game.tickLockAccumulator = 0; // reset if we moved down, in case we adjust the block after landing
+                steps.emplace_back(&game, &recorder, &input, &history, &autoplay);
             }
-        });
-}
 
+            auto now = InputClock::now();
+            float seconds = dt.value();
+            auto step = [&](int i) {
+                auto [game, recorder, input, history, autoplay] = steps[std::size_t(i)];
+                stepBoard(seconds, now, *game, *recorder, *input, *history, *autoplay);
+            };
+            if (steps.size() == 1)
+            {
+                step(0);
+            }
+            else
+            {
+                ThreadPool::shared().parallelFor(int(steps.size()), step);
+            }
+        });
 
+    cubos.system("publish game events")
+        .tagged(gameEventsTag)
+        .call([](Query<Entity, const GameBoard&, Game&> boards, EventWriter<GameEvent> events) {
+            for (auto [entity, board, game] : boards)
+            {
+                for (GameEventType type :
+                     {PIECE_LOCKED, PIECE_SPAWNED, PIECE_MOVED, PIECE_FELL, LINES_CLEARED, GAME_ENDED, GARBAGE_ADDED,
+                      BLOCKS_FELL})
+                {
+                    if ((game.events & type) != 0)
+                    {
+                        events.push(GameEvent{entity, board.index, board.local, type});
+                    }
+                }
+                game.events = 0;
+            }
+        });
+}
@@ -1,38 +1,130 @@
 #pragma once
 
 #include <cubos/engine/prelude.hpp>
+#include <cubos/engine/settings/settings.hpp>
+
+#include "actionQueue.hpp"
+#include "bot.hpp"
+#include "game.hpp"
+#include "replay.hpp"
+#include "rewind.hpp"
+
+#include <glm/vec3.hpp>
 
 #include <array>
-#include <vector>
+#include <optional>
+#include <string>
+
+// Every board is an entity with a Game and the components below which drive it, so any number of boards can run in
+// one world. Their logic steps are independent, and run in parallel on the shared thread pool.
+struct GameBoard
+{
+    CUBOS_REFLECT;
+
+    // Boards are numbered from 0 in the order they were spawned, and laid out side by side in that order.
+    int index = 0;
+    // Played from the keyboard, instead of only by the bot. Only the first board is, and replays, recordings, save
+    // states and the rewind tool apply to it alone.
+    bool local = false;
+    // Offset of the board from where gridToWorld places its cells.
+    glm::vec3 origin{0.0F};
+};
+
+// Records the inputs applied to the game, or plays a recording back in place of the player's inputs. Configured
+// through the "replay.record" and "replay.play" settings, which hold file paths, and "replay.speed", the number of
+// ticks replayed per tick period, where 0 replays everything as fast as possible.
+struct GameRecorder
+{
+    CUBOS_REFLECT;
+
+    std::string recordPath{};
+    std::string playPath{};
+    int replaySpeed = 1;
+
+    Recording recording{};
+    Replay replay{};
+    bool saved = false;
+
+    bool isRecording() const
+    {
+        return !recordPath.empty();
+    }
 
-struct Game
+    bool isReplaying() const
+    {
+        return !playPath.empty();
+    }
+};
+
+// Lets the bot play in place of the player. Toggled with the "autoplay" input action, or enabled from the start with
+// the "game.autoplay" setting. Boards which aren't local always play this way. The bot's inputs go through
+// playerAction, so they are recorded like any others.
+struct Autoplay
 {
     CUBOS_REFLECT;
 
-    float tickAccumulator = 0.0F;
-    float tickPeriod = 0.3F;
+    bool enabled = false;
+    Bot bot{};
+    BotPlan plan{};
+};
 
-    int ticksToLock = 3;
-    int tickLockAccumulator = 0;
+// History of the last "rewind.seconds" seconds of the game, which can be stepped back through. While paused the game
+// doesn't tick, and shows the tick picked from the history.
+struct GameHistory
+{
+    CUBOS_REFLECT;
 
-    std::vector<std::vector<std::vector<int>>> board = std::vector<std::vector<std::vector<int>>>(
-        10, std::vector<std::vector<int>>(20, std::vector<int>(10, 0)));
-    int boardGen = 0;
+    RewindBuffer buffer{};
+    bool paused = false;
+};
 
-    // Sparse floating piece
-    int floatingPieceColor = 0;
+// Player actions waiting for the next logic step, which applies them in order with the ticks it runs. Held moves
+// auto-repeat as configured by the "input.das" and "input.arr" settings, in seconds.
+struct PlayerInput
+{
+    CUBOS_REFLECT;
+
+    AutoRepeat repeat{};
+    std::vector<TimedAction> queue{};
+    // The up, down, right and left buttons, in that order.
+    std::array<HeldButton, 4> moves{};
 
-    // Coordinates of each block.
-    std::vector<int> blockX{};
-    std::vector<int> blockY{};
-    std::vector<int> blockZ{};
+    // When the earliest action which changed the game, but hasn't been shown yet, was made. Used to measure how long
+    // inputs take to become visible.
+    std::optional<InputClock::time_point> unshown{};
+};
 
-    int score;
+// Sent for each kind of thing which happened to a game during a frame. Systems which present the game read these
+// instead of polling it every frame.
+struct GameEvent
+{
+    // Entity of the board the game is on, along with its index and whether it is local, so that readers don't have to
+    // look the board up.
+    cubos::engine::Entity board;
+    int index;
+    bool local;
+    GameEventType type;
 };
 
-// North is +x, East is +z
-enum Direction { NORTH, EAST, SOUTH, WEST };
+// Systems which change the games. Player input is queued before them, and game events are published after them.
+extern cubos::engine::Tag gameLogicTag;
+// Game events for the current frame are available after this.
+extern cubos::engine::Tag gameEventsTag;
+
+// Applies an action coming from the player, and records it if recording is enabled. Returns true if the action
+// changed the game.
+bool playerAction(Game& game, GameRecorder& recorder, Action action);
+
+// Seed from the "game.seed" setting, or from the clock if it isn't set.
+uint64_t gameSeed(cubos::engine::Settings& settings);
+// Starts over in place, keeping the board size, settings and every entity. A replay starts over from its beginning,
+// and otherwise the new game gets the given seed, and the recording and history are cleared.
+void restartGame(Game& game, GameRecorder& recorder, GameHistory& history, PlayerInput& input, Autoplay& autoplay,
+                 uint64_t seed);
 
-bool moveBlock(Game& game, Direction dir);
+// Pauses the game and shows it as it was after the given tick. Returns false if the tick isn't in the history.
+bool showHistoryTick(GameHistory& history, Game& game, int tick);
+// Carries on playing from the tick shown, forgetting every tick and recorded input after it.
+void resumeFromHistory(GameHistory& history, const Game& game, GameRecorder& recorder, Autoplay& autoplay);
 
 void gameLogicPlugin(cubos::engine::Cubos& cubos);
@@ -0,0 +1,109 @@
+#include "lineClear.hpp"
+
+#include <bit>
+
+template <typename Dims>
+static LineClearResult findFullLinesKernel(const BoardRow* rows)
+{
+    LineClearResult result;
+    for (int y = 0; y < Dims::HEIGHT; ++y)
+    {
+        // An X-line is a full row, and a Z-line at x is full if bit x is set on every row of the layer.
+        BoardRow fullZLines = Dims::FULL_ROW;
+        for (int z = 0; z < Dims::DEPTH; ++z)
+        {
+            BoardRow row = rows[y * Dims::DEPTH + z];
+            if (row == Dims::FULL_ROW)
+            {
+                result.xLines[y] |= LineMask(1) << z;
+            }
+            fullZLines &= row;
+        }
+        result.zLines[y] = fullZLines;
+        result.count += std::popcount(result.xLines[y]) + std::popcount(result.zLines[y]);
+    }
+    return result;
+}
+
+LineClearResult findFullLines(const Board& board)
+{
+    return withBoardDims(board.preset,
+                         [&](auto dims) { return findFullLinesKernel<decltype(dims)>(board.rows.data()); });
+}
+
+LineClearResult firstLine(const LineClearResult& lines)
+{
+    LineClearResult result;
+    for (int y = 0; y < BOARD_MAX_HEIGHT; ++y)
+    {
+        if (lines.xLines[y] != 0)
+        {
+            result.xLines[y] = LineMask(1) << std::countr_zero(lines.xLines[y]);
+            result.count = 1;
+            return result;
+        }
+    }
+    for (int y = 0; y < BOARD_MAX_HEIGHT; ++y)
+    {
+        if (lines.zLines[y] != 0)
+        {
+            result.zLines[y] = LineMask(1) << std::countr_zero(lines.zLines[y]);
+            result.count = 1;
+            return result;
+        }
+    }
+    return result;
+}
+
+template <typename Dims>
+static void clearLinesKernel(Board& board, const LineClearResult& lines)
+{
+    // Nothing below the lowest cleared layer moves.
+    int lowestY = 0;
+    while (lines.xLines[lowestY] == 0 && lines.zLines[lowestY] == 0)
+    {
+        lowestY++;
+    }
+
+    for (int z = 0; z < Dims::DEPTH; ++z)
+    {
+        for (int x = 0; x < Dims::WIDTH; ++x)
+        {
+            // Layers removed from this column, by either an X-line or a Z-line crossing it.
+            uint32_t removed = 0;
+            for (int y = lowestY; y < Dims::HEIGHT; ++y)
+            {
+                if (((lines.xLines[y] >> z) | (lines.zLines[y] >> x)) & 1U)
+                {
+                    removed |= uint32_t(1) << y;
+                }
+            }
+            if (removed == 0)
+            {
+                continue;
+            }
+
+            int dst = std::countr_zero(removed);
+            for (int src = dst; src < Dims::HEIGHT; ++src)
+            {
+                if (((removed >> src) & 1U) == 0)
+                {
+                    board.set(x, dst++, z, board.color(x, src, z));
+                }
+            }
+            for (; dst < Dims::HEIGHT; ++dst)
+            {
+                board.set(x, dst, z, 0);
+            }
+        }
+    }
+}
+
+void clearLines(Board& board, const LineClearResult& lines)
+{
+    if (lines.count == 0)
+    {
+        return;
+    }
+    withBoardDims(board.preset, [&](auto dims) { clearLinesKernel<decltype(dims)>(board, lines); });
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "board.hpp"
+
+#include <array>
+#include <cstdint>
+
+// Bitmask over the lines of one layer, indexed by z for X-lines and by x for Z-lines.
+using LineMask = uint32_t;
+
+// Lines removed by a call to clearLines.
+struct LineClearResult
+{
+    // For each layer y, bit z is set if the X-line at (y, z) is cleared. Layers above the board are always empty.
+    std::array<LineMask, BOARD_MAX_HEIGHT> xLines{};
+    // For each layer y, bit x is set if the Z-line at (y, x) is cleared.
+    std::array<LineMask, BOARD_MAX_HEIGHT> zLines{};
+    int count = 0;
+};
+
+// Finds every full X-line and Z-line on the board.
+LineClearResult findFullLines(const Board& board);
+
+// Keeps only the line that would be cleared first when clearing one line at a time: X-lines before Z-lines, bottom
+// layer first.
+LineClearResult firstLine(const LineClearResult& lines);
+
+// Removes the given lines and compacts every affected column down, in a single pass over the board.
+void clearLines(Board& board, const LineClearResult& lines);
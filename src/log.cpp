@@ -0,0 +1,243 @@
+#include "log.hpp"
+
+#include <cubos/core/tel/logging.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct LogRecord
+{
+    int level;
+    const char* file;
+    int line;
+    const char* format;
+    int argCount;
+    int suppressed;
+    std::array<LogArg, LOG_MAX_ARGS> args;
+    std::array<char, LOG_MAX_TEXT> text;
+};
+
+// Fixed size queue of raw log records, drained by a background thread which does all the formatting.
+class LogQueue
+{
+public:
+    static LogQueue& instance()
+    {
+        static LogQueue queue;
+        return queue;
+    }
+
+    ~LogQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mWake.notify_one();
+        mWorker.join();
+    }
+
+    void push(const LogRecord& record)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mTail - mHead == CAPACITY)
+            {
+                mDropped++;
+                return;
+            }
+            mRecords[mTail++ % CAPACITY] = record;
+        }
+        mWake.notify_one();
+    }
+
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDrained.wait(lock, [this] { return mHead == mTail && !mWriting; });
+    }
+
+private:
+    static const std::size_t CAPACITY = 4096;
+
+    LogQueue()
+    {
+        mWorker = std::thread([this] { run(); });
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true)
+        {
+            mWake.wait(lock, [this] { return mStop || mHead != mTail; });
+            if (mHead == mTail)
+            {
+                return;
+            }
+
+            LogRecord record = mRecords[mHead++ % CAPACITY];
+            std::size_t dropped = mDropped;
+            mDropped = 0;
+            mWriting = true;
+            lock.unlock();
+
+            if (dropped > 0)
+            {
+                CUBOS_WARN("Log queue full, dropped {} messages", dropped);
+            }
+            write(record);
+
+            lock.lock();
+            mWriting = false;
+            if (mHead == mTail)
+            {
+                mDrained.notify_all();
+            }
+        }
+    }
+
+    static void append(std::string& out, const LogRecord& record, const LogArg& arg)
+    {
+        char buffer[32];
+        switch (arg.kind)
+        {
+        case LogArg::INT:
+            std::snprintf(buffer, sizeof(buffer), "%lld", (long long)arg.i);
+            break;
+        case LogArg::UINT:
+            std::snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)arg.u);
+            break;
+        case LogArg::DOUBLE:
+            std::snprintf(buffer, sizeof(buffer), "%g", arg.d);
+            break;
+        case LogArg::BOOL:
+            out += arg.b ? "true" : "false";
+            return;
+        case LogArg::STRING:
+            out += arg.s;
+            return;
+        case LogArg::TEXT:
+            out.append(record.text.data() + arg.text.offset, arg.text.length);
+            return;
+        }
+        out += buffer;
+    }
+
+    static void write(const LogRecord& record)
+    {
+        // Replace each {} in the format with the next argument.
+        std::string message;
+        int next = 0;
+        for (const char* c = record.format; *c != '\0'; c++)
+        {
+            if (c[0] == '{' && c[1] == '}' && next < record.argCount)
+            {
+                append(message, record, record.args[next++]);
+                c++;
+            }
+            else
+            {
+                message += *c;
+            }
+        }
+        if (record.suppressed > 0)
+        {
+            message += " (" + std::to_string(record.suppressed) + " similar messages suppressed)";
+        }
+
+        const char* file = record.file;
+        for (const char* c = record.file; *c != '\0'; c++)
+        {
+            if (*c == '/' || *c == '\\')
+            {
+                file = c + 1;
+            }
+        }
+
+        switch (record.level)
+        {
+        case GAME_LOG_LEVEL_TRACE:
+            CUBOS_TRACE("[{}:{}] {}", file, record.line, message);
+            break;
+        case GAME_LOG_LEVEL_DEBUG:
+            CUBOS_DEBUG("[{}:{}] {}", file, record.line, message);
+            break;
+        case GAME_LOG_LEVEL_INFO:
+            CUBOS_INFO("[{}:{}] {}", file, record.line, message);
+            break;
+        case GAME_LOG_LEVEL_WARN:
+            CUBOS_WARN("[{}:{}] {}", file, record.line, message);
+            break;
+        case GAME_LOG_LEVEL_ERROR:
+            CUBOS_ERROR("[{}:{}] {}", file, record.line, message);
+            break;
+        default:
+            CUBOS_CRITICAL("[{}:{}] {}", file, record.line, message);
+            break;
+        }
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDrained;
+    std::array<LogRecord, CAPACITY> mRecords{};
+    std::size_t mHead = 0;
+    std::size_t mTail = 0;
+    std::size_t mDropped = 0;
+    bool mWriting = false;
+    bool mStop = false;
+    std::thread mWorker;
+};
+
+bool LogRateLimiter::allow(int& suppressedBefore)
+{
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+    int64_t last = second.load(std::memory_order_relaxed);
+    if (now != last && second.compare_exchange_strong(last, now, std::memory_order_relaxed))
+    {
+        count.store(0, std::memory_order_relaxed);
+        suppressedBefore = suppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+    if (count.fetch_add(1, std::memory_order_relaxed) < GAME_LOG_RATE)
+    {
+        return true;
+    }
+    suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void pushLog(int level, const char* file, int line, const char* format, const LogArg* args, int argCount,
+             int suppressed)
+{
+    LogRecord record{level, file, line, format, argCount, suppressed, {}, {}};
+    std::size_t used = 0;
+    for (int i = 0; i < argCount; i++)
+    {
+        record.args[i] = args[i];
+        if (args[i].kind == LogArg::TEXT)
+        {
+            // Strings past the space left are cut short, rather than dropping the message.
+            std::size_t length = std::min(std::strlen(args[i].s), std::size_t(LOG_MAX_TEXT) - used);
+            std::memcpy(record.text.data() + used, args[i].s, length);
+            record.args[i].text = {uint16_t(used), uint16_t(length)};
+            used += length;
+        }
+    }
+    LogQueue::instance().push(record);
+}
+
+void flushLog()
+{
+    LogQueue::instance().flush();
+}
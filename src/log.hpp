@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// Game-level logging for hot paths. Messages below GAME_LOG_LEVEL are compiled out entirely, arguments included. The
+// rest are rate limited per call site, which is checked before the arguments are evaluated, so a message held back
+// costs the limiter's check and nothing else. Messages let through are handed to a background thread as raw values,
+// so that the calling thread never formats strings. Formatted messages end up in the engine's log.
+//
+// Only arithmetic values, string literals and std::strings can be passed as arguments, since they are formatted later
+// on. The contents of std::strings are copied into the message, up to LOG_MAX_TEXT bytes between them.
+
+#define GAME_LOG_LEVEL_TRACE 0
+#define GAME_LOG_LEVEL_DEBUG 1
+#define GAME_LOG_LEVEL_INFO 2
+#define GAME_LOG_LEVEL_WARN 3
+#define GAME_LOG_LEVEL_ERROR 4
+#define GAME_LOG_LEVEL_CRITICAL 5
+#define GAME_LOG_LEVEL_OFF 6
+
+#ifndef GAME_LOG_LEVEL
+#ifdef NDEBUG
+#define GAME_LOG_LEVEL GAME_LOG_LEVEL_INFO
+#else
+#define GAME_LOG_LEVEL GAME_LOG_LEVEL_TRACE
+#endif
+#endif
+
+// Maximum number of messages per second logged from a single call site, below the warning level.
+#ifndef GAME_LOG_RATE
+#define GAME_LOG_RATE 20
+#endif
+
+const int LOG_MAX_ARGS = 6;
+const int LOG_MAX_TEXT = 128;
+
+struct LogArg
+{
+    enum Kind : uint8_t
+    {
+        INT,
+        UINT,
+        DOUBLE,
+        BOOL,
+        STRING,
+        // A string which is copied into the message. Points at the caller's string until it is queued, and is then
+        // found by its position in the message's text.
+        TEXT
+    };
+
+    Kind kind;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        bool b;
+        const char* s;
+        struct
+        {
+            uint16_t offset;
+            uint16_t length;
+        } text;
+    };
+};
+
+template <typename T>
+LogArg makeLogArg(const T& value)
+{
+    LogArg arg{};
+    if constexpr (std::is_same_v<T, std::string>)
+    {
+        arg.kind = LogArg::TEXT;
+        arg.s = value.c_str();
+    }
+    else if constexpr (std::is_same_v<T, bool>)
+    {
+        arg.kind = LogArg::BOOL;
+        arg.b = value;
+    }
+    else if constexpr (std::is_enum_v<T> || (std::is_integral_v<T> && std::is_signed_v<T>))
+    {
+        arg.kind = LogArg::INT;
+        arg.i = int64_t(value);
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        arg.kind = LogArg::UINT;
+        arg.u = uint64_t(value);
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        arg.kind = LogArg::DOUBLE;
+        arg.d = double(value);
+    }
+    else
+    {
+        static_assert(std::is_convertible_v<const T&, const char*>,
+                      "only arithmetic values, string literals and std::strings can be logged");
+        arg.kind = LogArg::STRING;
+        arg.s = value;
+    }
+    return arg;
+}
+
+// Lets through at most GAME_LOG_RATE messages per second, and counts the ones it holds back.
+struct LogRateLimiter
+{
+    std::atomic<int64_t> second{-1};
+    std::atomic<int> count{0};
+    std::atomic<int> suppressed{0};
+
+    // Returns true if a message may be logged. If messages were held back during the previous second, their number is
+    // written to suppressedBefore.
+    bool allow(int& suppressedBefore);
+};
+
+// Queues a message for the background thread, copying the contents of its TEXT arguments. Drops it if the queue is
+// full.
+void pushLog(int level, const char* file, int line, const char* format, const LogArg* args, int argCount,
+             int suppressed);
+
+// Blocks until every queued message has been written.
+void flushLog();
+
+// Called once the message got past its call site's limiter, with how many it held back before.
+template <typename... Args>
+void gameLog(int level, const char* file, int line, int suppressed, const char* format, const Args&... args)
+{
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+    LogArg packed[sizeof...(Args) + 1] = {makeLogArg(args)...};
+    pushLog(level, file, line, format, packed, int(sizeof...(Args)), suppressed);
+}
+
+#define GAME_LOG(level, ...)                                                                                           \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if constexpr ((level) >= GAME_LOG_LEVEL)                                                                       \
+        {                                                                                                              \
+            static LogRateLimiter gameLogLimiter;                                                                      \
+            int gameLogSuppressed = 0;                                                                                 \
+            if ((level) >= GAME_LOG_LEVEL_WARN || gameLogLimiter.allow(gameLogSuppressed))                             \
+            {                                                                                                          \
+                gameLog(level, __FILE__, __LINE__, gameLogSuppressed, __VA_ARGS__);                                    \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (false)
+
+#define GAME_TRACE(...) GAME_LOG(GAME_LOG_LEVEL_TRACE, __VA_ARGS__)
+#define GAME_DEBUG(...) GAME_LOG(GAME_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define GAME_INFO(...) GAME_LOG(GAME_LOG_LEVEL_INFO, __VA_ARGS__)
+#define GAME_WARN(...) GAME_LOG(GAME_LOG_LEVEL_WARN, __VA_ARGS__)
+#define GAME_ERROR(...) GAME_LOG(GAME_LOG_LEVEL_ERROR, __VA_ARGS__)
+#define GAME_CRITICAL(...) GAME_LOG(GAME_LOG_LEVEL_CRITICAL, __VA_ARGS__)
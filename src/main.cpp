@@ -1,5 +1,7 @@
 #include "camera.hpp"
 
+#include <cubos/core/data/fs/file_system.hpp>
+
 #include <cubos/engine/assets/plugin.hpp>
 #include <cubos/engine/collisions/colliding_with.hpp>
 #include <cubos/engine/defaults/plugin.hpp>
@@ -12,12 +14,21 @@
 #include <cubos/engine/utils/free_camera/plugin.hpp>
 #include <cubos/engine/render/camera/perspective.hpp>
 
+#include "assetPack.hpp"
+#include "audioAudioPlugin.hpp"
+#include "boardGrid.hpp"
 #include "cube.hpp"
 #include "gameLogic.hpp"
+#include "log.hpp"
+#include "profiler.hpp"
+#include "rewindTool.hpp"
+#include "snapshot.hpp"
+#include "timings.hpp"
 #include "utils.hpp"
 
 #include <cubos/engine/transform/position.hpp>
 #include <cubos/engine/transform/rotation.hpp>
+#include <cubos/engine/transform/scale.hpp>
 
 using namespace cubos::engine;
 
@@ -26,6 +37,77 @@ static const Asset<Scene> CubeAsset = AnyAsset("/assets/scenes/cube.cubos");
 static const Asset<VoxelPalette> PaletteAsset = AnyAsset("/assets/main.pal");
 static const Asset<InputBindings> InputBindingsAsset = AnyAsset("/assets/input.bind");
 
+// Moves a board's cubes to match the cells which changed since the last call, reusing the cubes of emptied cells.
+static void trackBoardCubes(Commands& cmds, const Assets& assets, Entity owner, const GameBoard& gameBoard,
+                            Board& board, BoardCubes& boardCubes)
+{
+    const auto& dirtyCells = board.dirtyCells;
+    if (dirtyCells.empty())
+    {
+        return;
+    }
+    if (boardCubes.cells.empty())
+    {
+        boardCubes.cells.resize(board.colors.size());
+    }
+
+    GAME_DEBUG("Syncing {} changed cells", dirtyCells.size());
+
+    // Park the cubes of emptied cells first, so that cells filled on the same tick can reuse them.
+    int x, y, z;
+    int filled = 0;
+    for (int cell : dirtyCells)
+    {
+        board.cellCoords(cell, x, y, z);
+        Entity& ent = boardCubes.cells[cell];
+        bool occupied = board.occupied(x, y, z);
+        if (!ent.isNull() && !occupied)
+        {
+            cmds.add(ent, Position{PARKED_POS});
+            cmds.add(ent, StationaryCube{-1, owner});
+            boardCubes.pool.push_back(ent);
+            ent = Entity{};
+        }
+        else if (ent.isNull() && occupied)
+        {
+            filled++;
+        }
+    }
+
+    // Only spawn new cubes when the pool runs out, all from a single read of the cube scene.
+    if (filled > int(boardCubes.pool.size()))
+    {
+        auto cubeScene = assets.read(CubeAsset);
+        for (int i = int(boardCubes.pool.size()); i < filled; i++)
+        {
+            boardCubes.pool.push_back(cmds.spawn(*cubeScene)
+                                          .named("cube")
+                                          .add(Position{PARKED_POS})
+                                          .add(StationaryCube{-1, owner})
+                                          .entity());
+        }
+    }
+
+    for (int cell : dirtyCells)
+    {
+        board.cellCoords(cell, x, y, z);
+        Entity& ent = boardCubes.cells[cell];
+        if (!ent.isNull() || !board.occupied(x, y, z))
+        {
+            continue;
+        }
+
+        ent = boardCubes.pool.back();
+        boardCubes.pool.pop_back();
+        Position pos;
+        pos.vec = gameBoard.origin + gridToWorld(board, x, y, z);
+        cmds.add(ent, pos);
+        cmds.add(ent, StationaryCube{cell, owner});
+    }
+
+    board.clearDirty();
+}
+
 int main(int argc, char** argv)
 {
     Cubos cubos{argc, argv};
@@ -34,12 +116,31 @@ int main(int argc, char** argv)
     cubos.plugin(freeCameraPlugin);
     cubos.plugin(toolsPlugin);
     cubos.plugin(gameLogicPlugin);
+    cubos.plugin(boardGridPlugin);
     cubos.plugin(cubePlugin);
     cubos.plugin(cameraPlugin);
+    cubos.plugin(timingsPlugin);
+    cubos.plugin(rewindToolPlugin);
+    cubos.plugin(audioAudioPlugin);
 
-    cubos.startupSystem("configure settings").before(settingsTag).call([](Settings& settings) {
+    cubos.startupSystem("configure settings").before(settingsTag).call([](Settings& settings, StartupTimer& startup) {
         settings.setString("assets.app.osPath", APP_ASSETS_PATH);
         settings.setString("assets.builtin.osPath", BUILTIN_ASSETS_PATH);
+
+#ifdef APP_ASSETS_PACK
+        // A baked pack replaces the loose assets directory. Clearing the path keeps the assets plugin from mounting
+        // the directory over it.
+        if (auto pack = PackArchive::load(APP_ASSETS_PACK))
+        {
+            std::size_t files = pack->fileCount();
+            if (cubos::core::data::FileSystem::mount("/assets", std::move(pack)))
+            {
+                GAME_INFO("Serving {} asset files from {}", files, APP_ASSETS_PACK);
+                settings.setString("assets.app.osPath", "");
+                startup.assetSource = "the asset pack";
+            }
+        }
+#endif
     });
 
     cubos.startupSystem("set the palette, environment, input bindings and spawn the scene")
@@ -66,79 +167,151 @@ int main(int argc, char** argv)
         }
     });
 
+    // Only the games are reset. The scene stays, and the cubes of the old boards go back to the pool as their cells
+    // empty. Each board keeps its seed offset from the first one.
     cubos.system("restart the game on input")
-        .call([](Commands cmds, const Assets& assets, const Input& input, Query<Entity> all) {
+        .before(gameLogicTag)
+        .call([](Settings& settings, const Input& input,
+                 Query<const GameBoard&, Game&, GameRecorder&, GameHistory&, PlayerInput&, Autoplay&> boards) {
+            PROFILE_SCOPE("restart the game on input");
+
             if (input.justPressed("restart"))
             {
-                for (auto [ent] : all)
+                uint64_t seed = gameSeed(settings);
+                for (auto [board, game, recorder, history, playerInput, autoplay] : boards)
                 {
-                    cmds.destroy(ent);
+                    restartGame(game, recorder, history, playerInput, autoplay, seed + uint64_t(board.index));
                 }
-
-                cmds.spawn(assets.read(SceneAsset)->blueprint()).named("main");
             }
         });
 
-    cubos.system("spawn cubes for the falling block")
-        .call([](Commands cmds, const Assets& assets, const Game& game, Query<const Cube&> existingCubes) {
-            int numBlocks = game.blockX.size();
-            int existingCubesCount = 0;
-            for (auto [cube] : existingCubes)
+    // Save states of the local board are written to and read from the file in the "snapshot.path" setting.
+    cubos.system("save and load states on input")
+        .tagged(gameLogicTag)
+        .call([](Settings& settings, const Input& input, Query<const GameBoard&, Game&, GameHistory&> boards) {
+            if (!input.justPressed("save-state") && !input.justPressed("load-state"))
+            {
+                return;
+            }
+            Game* local = nullptr;
+            GameHistory* history = nullptr;
+            for (auto [board, game, boardHistory] : boards)
+            {
+                if (board.local)
+                {
+                    local = &game;
+                    history = &boardHistory;
+                }
+            }
+            if (local == nullptr)
+            {
+                return;
+            }
+            Game& game = *local;
+
+            std::string path = settings.getString("snapshot.path", "game.snap");
+            if (input.justPressed("save-state"))
             {
-                (void)cube;
-                existingCubesCount++;
+                PROFILE_SCOPE("save state");
+                if (saveSnapshot(game, path))
+                {
+                    GAME_INFO("Saved the game to {}", path);
+                }
+                else
+                {
+                    GAME_ERROR("Could not save the game to {}", path);
+                }
             }
 
-            for (int i = existingCubesCount; i < numBlocks; i++)
+            if (input.justPressed("load-state"))
             {
-                CUBOS_INFO("Creating cube for block index {}", i);
-                cmds.spawn(*assets.read(CubeAsset)).named("cube").add(Cube{i});
+                PROFILE_SCOPE("load state");
+                Game loaded;
+                if (!loadSnapshot(path, loaded))
+                {
+                    GAME_ERROR("Could not load the game from {}", path);
+                    return;
+                }
+                if (loaded.board.preset != game.board.preset)
+                {
+                    GAME_ERROR("Can't load a {} board over a {} one", boardPresetName(loaded.board.preset),
+                               boardPresetName(game.board.preset));
+                    return;
+                }
+
+                // Cells which are only filled on the old board have to be emptied too.
+                loaded.board.markChangedFrom(game.board);
+                game = std::move(loaded);
+                // The changed cells may be synced, and no longer dirty, before the next tick is recorded.
+                history->buffer.fullDiff = true;
+                GAME_INFO("Loaded the game from {}", path);
             }
         });
 
-    cubos.system("track existing cubes")
-    .call([](Commands cmds, const Assets& assets, const Game& game, Query<Entity, const StationaryCube&> cubes) {
-        bool needsUpdate = cubes.count() == 0;
-
-        int count = 0;
-        for (auto [ent, cube] : cubes)
-        {
+    cubos.system("spawn cubes for the falling block")
+        .call([](Commands cmds, const Assets& assets, Query<Entity, FallingCubes&> boards) {
+            PROFILE_SCOPE("spawn cubes for the falling block");
 
-            if (cube.gen < game.boardGen)
-            {
-                cmds.destroy(ent);
-                needsUpdate = true;
-                count++;
-            } else
+            for (auto [board, falling] : boards)
             {
-                break;
+                if (!falling.cubes.empty())
+                {
+                    continue;
+                }
+
+                auto cubeScene = assets.read(CubeAsset);
+                for (int i = 0; i < PIECE_BLOCKS; i++)
+                {
+                    GAME_TRACE("Creating cube for block index {}", i);
+                    falling.cubes.push_back(cmds.spawn(*cubeScene)
+                                                .named("cube")
+                                                .add(Cube{i, board})
+                                                .add(Position{PARKED_POS})
+                                                .entity());
+                    falling.ghosts.push_back(cmds.spawn(*cubeScene)
+                                                 .named("ghost")
+                                                 .add(GhostCube{i, board})
+                                                 .add(Position{PARKED_POS})
+                                                 .add(Scale{GHOST_SCALE})
+                                                 .entity());
+                }
+                falling.stale = true;
             }
-        }
+        });
 
-        if (needsUpdate && game.boardGen > 0)
+    cubos.system("report the startup time").call([](StartupTimer& startup, Query<const FallingCubes&> boards) {
+        // The game can be played once the cubes of a falling piece exist.
+        if (startup.reported())
         {
-            CUBOS_INFO("Deleted {} old cubes for gen {}", count, game.boardGen);
-            CUBOS_INFO("Updating board to gen {}", game.boardGen);
-            for (int x = 0; x < 10; x++)
+            return;
+        }
+        for (auto [falling] : boards)
+        {
+            if (falling.cubes.empty())
             {
-                for (int y = 0; y < 20; y++)
-                {
-                    for (int z = 0; z < 10; z++)
-                    {
-                        if (game.board[x][y][z] != 0)
-                        {
-                            Position pos;
-                            pos.vec = gridToWorld(x, y, z);
-                            cmds.spawn(*assets.read(CubeAsset))
-                                    .named("cube")
-                                    .add(pos)
-                                    .add(StationaryCube{game.boardGen});
-                        }
-                    }
-                }
+                continue;
             }
+            startup.milliseconds =
+                std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startup.start).count();
+            GAME_INFO("First playable frame after {} ms, assets from {}", startup.milliseconds, startup.assetSource);
+            return;
         }
     });
+
+    cubos.system("track existing cubes")
+        .call([](Commands cmds, const Assets& assets, const BoardGrid& grid,
+                 Query<Entity, const GameBoard&, Game&, BoardCubes&> boards) {
+            PROFILE_SCOPE("track existing cubes");
+
+            if (grid.enabled)
+            {
+                return;
+            }
+            for (auto [entity, board, game, boardCubes] : boards)
+            {
+                trackBoardCubes(cmds, assets, entity, board, game.board, boardCubes);
+            }
+        });
     /*
 
     cubos.system("detect player vs obstacle collisions")
@@ -0,0 +1,54 @@
+// Bakes an assets directory into a single pack which the game memory maps at startup.
+//
+// Usage: game_pack ASSETS_DIR OUTPUT
+
+#include "packFormat.hpp"
+
+#include <cstdio>
+#include <filesystem>
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        std::fprintf(stderr, "Usage: %s ASSETS_DIR OUTPUT\n", argv[0]);
+        return 1;
+    }
+
+    std::filesystem::path root = argv[1];
+    std::vector<PackEntry> entries;
+    std::error_code error;
+    for (const auto& file : std::filesystem::recursive_directory_iterator(root, error))
+    {
+        if (file.is_regular_file())
+        {
+            entries.push_back({file.path().lexically_relative(root).generic_string(), 0, 0});
+        }
+    }
+    if (error)
+    {
+        std::fprintf(stderr, "Could not read %s: %s\n", argv[1], error.message().c_str());
+        return 1;
+    }
+
+    // Sorted, so that the pack is the same whatever order the directory is listed in.
+    std::sort(entries.begin(), entries.end(), [](const PackEntry& a, const PackEntry& b) { return a.path < b.path; });
+    std::vector<std::vector<uint8_t>> contents(entries.size());
+    for (std::size_t i = 0; i < entries.size(); i++)
+    {
+        if (!readFile((root / entries[i].path).string(), contents[i]))
+        {
+            std::fprintf(stderr, "Could not read %s\n", entries[i].path.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> pack = writePack(entries, contents);
+    if (!writeFile(argv[2], pack))
+    {
+        std::fprintf(stderr, "Could not write %s\n", argv[2]);
+        return 1;
+    }
+    std::printf("Packed %zu files into %s, %zu bytes\n", entries.size(), argv[2], pack.size());
+    return 0;
+}
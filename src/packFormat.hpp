@@ -0,0 +1,97 @@
+#pragma once
+
+#include "bytes.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Asset packs hold every file of the assets directory in one file, so that the game opens a single file at startup
+// instead of walking the directory and opening each asset and .meta file. The header is the magic, version and entry
+// count, followed by each entry's path length, path, offset and size, sorted by path. File contents follow, each
+// starting at a multiple of PACK_ALIGNMENT, so they can be used in place from a memory mapping.
+
+const char PACK_MAGIC[4] = {'C', 'J', 'P', 'K'};
+const uint8_t PACK_VERSION = 1;
+const std::size_t PACK_ALIGNMENT = 16;
+
+struct PackEntry
+{
+    // Relative to the assets directory, with forward slashes.
+    std::string path;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Lays out the pack for the given files, whose contents are in the same order, and fills in their offsets.
+inline std::vector<uint8_t> writePack(std::vector<PackEntry>& entries,
+                                      const std::vector<std::vector<uint8_t>>& contents)
+{
+    std::vector<uint8_t> header(PACK_MAGIC, PACK_MAGIC + 4);
+    header.push_back(PACK_VERSION);
+    writeLE(header, entries.size(), 4);
+    std::size_t headerSize = header.size();
+    for (const auto& entry : entries)
+    {
+        headerSize += 2 + entry.path.size() + 8 + 8;
+    }
+
+    uint64_t offset = headerSize;
+    for (std::size_t i = 0; i < entries.size(); i++)
+    {
+        offset = (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+        entries[i].offset = offset;
+        entries[i].size = contents[i].size();
+        offset += contents[i].size();
+
+        writeLE(header, entries[i].path.size(), 2);
+        header.insert(header.end(), entries[i].path.begin(), entries[i].path.end());
+        writeLE(header, entries[i].offset, 8);
+        writeLE(header, entries[i].size, 8);
+    }
+
+    header.resize(std::size_t(offset), 0);
+    for (std::size_t i = 0; i < entries.size(); i++)
+    {
+        std::copy(contents[i].begin(), contents[i].end(), header.begin() + std::ptrdiff_t(entries[i].offset));
+    }
+    return header;
+}
+
+// Reads the entries of a pack. Returns false if it is truncated, from another version, or an entry points outside it.
+inline bool readPack(const uint8_t* data, std::size_t size, std::vector<PackEntry>& entries)
+{
+    if (size < 9 || !std::equal(PACK_MAGIC, PACK_MAGIC + 4, data) || data[4] != PACK_VERSION)
+    {
+        return false;
+    }
+    uint32_t count = uint32_t(readLE(data + 5, 4));
+    std::size_t pos = 9;
+    entries.clear();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (pos + 2 > size)
+        {
+            return false;
+        }
+        std::size_t length = std::size_t(readLE(data + pos, 2));
+        pos += 2;
+        if (pos + length + 16 > size)
+        {
+            return false;
+        }
+        PackEntry entry;
+        entry.path.assign(reinterpret_cast<const char*>(data + pos), length);
+        entry.offset = readLE(data + pos + length, 8);
+        entry.size = readLE(data + pos + length + 8, 8);
+        pos += length + 16;
+        if (entry.offset > size || entry.size > size - entry.offset)
+        {
+            return false;
+        }
+        entries.push_back(std::move(entry));
+    }
+    return true;
+}
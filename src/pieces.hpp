@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Compile-time piece library. Every orientation each piece can reach by quarter turns around the X, Y and Z axes is
+// precomputed, along with the orientation each turn leads to, so spawning and rotating pieces is just table lookups.
+
+const int PIECE_TYPES = 7;
+const int PIECE_BLOCKS = 4;
+// A cube has 24 rotations, so no piece can have more orientations than that.
+const int MAX_ORIENTATIONS = 24;
+
+enum PieceType { PIECE_I, PIECE_O, PIECE_T, PIECE_L, PIECE_J, PIECE_S, PIECE_Z };
+
+enum Axis { AXIS_X, AXIS_Y, AXIS_Z };
+
+// An offset, in cells. Used both for blocks relative to the piece pivot and for kicks.
+struct PieceCell
+{
+    int8_t x;
+    int8_t y;
+    int8_t z;
+};
+
+using PieceShape = std::array<PieceCell, PIECE_BLOCKS>;
+
+struct PieceTable
+{
+    std::array<int, PIECE_TYPES> orientationCount{};
+    std::array<std::array<PieceShape, MAX_ORIENTATIONS>, PIECE_TYPES> orientations{};
+    // Orientation reached from each orientation by a quarter turn around each axis, clockwise ([0]) or
+    // counter-clockwise ([1]) when looking down the axis.
+    std::array<std::array<std::array<std::array<uint8_t, 2>, 3>, MAX_ORIENTATIONS>, PIECE_TYPES> rotations{};
+};
+
+// Shapes as they spawn, flat on the XZ plane, relative to the spawn corner. dy is always 0 for a flat spawn.
+inline constexpr std::array<PieceShape, PIECE_TYPES> PIECE_SPAWN_SHAPES = {{
+    // I-piece (Line)
+    {{{0, 0, 0}, {0, 0, 1}, {0, 0, 2}, {0, 0, 3}}},
+    // O-piece (Square)
+    {{{0, 0, 0}, {1, 0, 0}, {0, 0, 1}, {1, 0, 1}}},
+    // T-piece
+    {{{0, 0, 0}, {1, 0, 0}, {2, 0, 0}, {1, 0, -1}}},
+    // L-piece
+    {{{0, 0, 0}, {0, 0, 1}, {0, 0, 2}, {1, 0, 2}}},
+    // J-piece (Reversed L)
+    {{{1, 0, 0}, {1, 0, 1}, {1, 0, 2}, {0, 0, 2}}},
+    // S-piece
+    {{{1, 0, 0}, {2, 0, 0}, {0, 0, 1}, {1, 0, 1}}},
+    // Z-piece (Reversed S)
+    {{{0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {2, 0, 1}}},
+}};
+
+// Index of the block of each spawn shape which the piece rotates around.
+inline constexpr std::array<int, PIECE_TYPES> PIECE_PIVOTS = {1, 0, 1, 1, 1, 0, 1};
+
+// Offsets tried, in order, when a rotated piece overlaps something: stay put, step sideways away from a wall or the
+// stack, and for the I-piece, which sticks out further, step away by two. None goes up, as a grounded piece could
+// otherwise climb a cell with every blocked turn and never lock.
+inline constexpr std::array<PieceCell, 9> PIECE_KICKS = {{
+    {0, 0, 0},
+    {1, 0, 0},
+    {-1, 0, 0},
+    {0, 0, 1},
+    {0, 0, -1},
+    {2, 0, 0},
+    {-2, 0, 0},
+    {0, 0, 2},
+    {0, 0, -2},
+}};
+
+constexpr int pieceKickCount(int type)
+{
+    return type == PIECE_I ? 9 : 5;
+}
+
+constexpr PieceCell rotateCell(PieceCell c, int axis)
+{
+    switch (axis)
+    {
+    case AXIS_X:
+        return {c.x, int8_t(-c.z), c.y};
+    case AXIS_Y:
+        return {c.z, c.y, int8_t(-c.x)};
+    default:
+        return {int8_t(-c.y), c.x, c.z};
+    }
+}
+
+constexpr bool sameShape(const PieceShape& a, const PieceShape& b)
+{
+    for (const auto& ca : a)
+    {
+        bool found = false;
+        for (const auto& cb : b)
+        {
+            found = found || (ca.x == cb.x && ca.y == cb.y && ca.z == cb.z);
+        }
+        if (!found)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr PieceTable buildPieceTable()
+{
+    PieceTable table{};
+    for (int type = 0; type < PIECE_TYPES; type++)
+    {
+        auto& orientations = table.orientations[type];
+        auto& rotations = table.rotations[type];
+        int& count = table.orientationCount[type];
+
+        // Start from the spawn shape, relative to its pivot.
+        const auto& spawn = PIECE_SPAWN_SHAPES[type];
+        const auto& pivot = spawn[PIECE_PIVOTS[type]];
+        for (int i = 0; i < PIECE_BLOCKS; i++)
+        {
+            orientations[0][i] = {int8_t(spawn[i].x - pivot.x), int8_t(spawn[i].y - pivot.y),
+                                  int8_t(spawn[i].z - pivot.z)};
+        }
+        count = 1;
+
+        // The O-piece has no block at its center to turn around, and turning it around a corner would shift it by a
+        // cell, so it keeps its spawn orientation, which every turn leads back to.
+        if (type == PIECE_O)
+        {
+            continue;
+        }
+
+        // Explore every orientation reachable through clockwise quarter turns.
+        for (int from = 0; from < count; from++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                PieceShape rotated{};
+                for (int i = 0; i < PIECE_BLOCKS; i++)
+                {
+                    rotated[i] = rotateCell(orientations[from][i], axis);
+                }
+
+                int to = 0;
+                while (to < count && !sameShape(orientations[to], rotated))
+                {
+                    to++;
+                }
+                if (to == count)
+                {
+                    orientations[count++] = rotated;
+                }
+                rotations[from][axis][0] = uint8_t(to);
+            }
+        }
+
+        // Three clockwise turns make a counter-clockwise one.
+        for (int from = 0; from < count; from++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                int to = from;
+                for (int turn = 0; turn < 3; turn++)
+                {
+                    to = rotations[to][axis][0];
+                }
+                rotations[from][axis][1] = uint8_t(to);
+            }
+        }
+    }
+    return table;
+}
+
+inline constexpr PieceTable PIECES = buildPieceTable();
+
+static_assert(PIECES.orientationCount[PIECE_O] == 1 && PIECES.rotations[PIECE_O][0][AXIS_X][0] == 0,
+              "the O-piece should never turn");
+static_assert(PIECES.orientationCount[PIECE_I] < PIECES.orientationCount[PIECE_L],
+              "symmetric pieces should have fewer distinct orientations");
+static_assert(PIECES.rotations[PIECE_T][PIECES.rotations[PIECE_T][0][AXIS_Y][0]][AXIS_Y][1] == 0,
+              "counter-clockwise turns should undo clockwise ones");
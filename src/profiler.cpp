@@ -0,0 +1,171 @@
+#include "profiler.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+int Profiler::site(const char* name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (int i = 0; i < int(mSeries.size()); i++)
+    {
+        if (mSeries[std::size_t(i)].name == name || std::strcmp(mSeries[std::size_t(i)].name, name) == 0)
+        {
+            return i;
+        }
+    }
+    if (int(mSeries.size()) == PROFILE_MAX_SITES)
+    {
+        return -1;
+    }
+    mSeries.emplace_back().name = name;
+    return int(mSeries.size()) - 1;
+}
+
+Profiler::ThreadTotals& Profiler::threadTotals()
+{
+    static thread_local std::shared_ptr<ThreadTotals> totals;
+    if (totals == nullptr)
+    {
+        totals = std::make_shared<ThreadTotals>();
+        totals->thread = uint32_t(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        std::lock_guard<std::mutex> lock(mMutex);
+        mThreads.push_back(totals);
+    }
+    return *totals;
+}
+
+void Profiler::record(int site, Clock::time_point start, Clock::time_point end)
+{
+    if (site < 0)
+    {
+        return;
+    }
+
+    // Only this thread writes its totals, so a plain load and store is enough.
+    ThreadTotals& totals = threadTotals();
+    auto& nanos = totals.nanos[std::size_t(site)];
+    auto& calls = totals.calls[std::size_t(site)];
+    nanos.store(nanos.load(std::memory_order_relaxed) +
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+                std::memory_order_relaxed);
+    calls.store(calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    if (mTracing.load(std::memory_order_acquire))
+    {
+        if (mTraceEvents.fetch_add(1, std::memory_order_relaxed) >= MAX_TRACE_EVENTS)
+        {
+            mTracing.store(false, std::memory_order_relaxed);
+            return;
+        }
+        Clock::time_point traceStart{Clock::duration(mTraceStart.load(std::memory_order_relaxed))};
+        auto micros = [traceStart](Clock::time_point t) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(t - traceStart).count();
+        };
+        std::lock_guard<std::mutex> lock(totals.traceMutex);
+        totals.trace.push_back({site, micros(start), micros(end) - micros(start), totals.thread});
+    }
+}
+
+void Profiler::record(const char* name, Clock::time_point start, Clock::time_point end)
+{
+    record(site(name), start, end);
+}
+
+void Profiler::merge()
+{
+    for (auto& totals : mThreads)
+    {
+        for (std::size_t site = 0; site < mSeries.size(); site++)
+        {
+            int64_t nanos = totals->nanos[site].load(std::memory_order_relaxed);
+            int32_t calls = totals->calls[site].load(std::memory_order_relaxed);
+            mSeries[site].current += float(nanos - totals->mergedNanos[site]) / 1e6F;
+            mSeries[site].calls += calls - totals->mergedCalls[site];
+            totals->mergedNanos[site] = nanos;
+            totals->mergedCalls[site] = calls;
+        }
+    }
+}
+
+void Profiler::endFrame()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    merge();
+    for (auto& series : mSeries)
+    {
+        series.frames[series.offset] = series.current;
+        series.offset = (series.offset + 1) % PROFILE_HISTORY;
+        series.current = 0.0F;
+        series.calls = 0;
+    }
+}
+
+std::vector<ProfileSeries> Profiler::series()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    merge();
+    return mSeries;
+}
+
+void Profiler::startTrace()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& totals : mThreads)
+    {
+        std::lock_guard<std::mutex> traceLock(totals->traceMutex);
+        totals->trace.clear();
+    }
+    mTraceEvents.store(0, std::memory_order_relaxed);
+    mTraceStart.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    mTracing.store(true, std::memory_order_release);
+}
+
+bool Profiler::tracing()
+{
+    return mTracing.load(std::memory_order_relaxed);
+}
+
+bool Profiler::saveTrace(const std::string& path)
+{
+    std::vector<TraceEvent> trace;
+    std::vector<const char*> names;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTracing.store(false, std::memory_order_relaxed);
+        for (auto& totals : mThreads)
+        {
+            std::lock_guard<std::mutex> traceLock(totals->traceMutex);
+            trace.insert(trace.end(), totals->trace.begin(), totals->trace.end());
+            totals->trace.clear();
+        }
+        for (const auto& series : mSeries)
+        {
+            names.push_back(series.name);
+        }
+    }
+
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    std::fputs("{\"traceEvents\":[\n", file);
+    for (std::size_t i = 0; i < trace.size(); i++)
+    {
+        const auto& event = trace[i];
+        std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%u}%s\n",
+                     names[std::size_t(event.site)], (long long)event.start, (long long)event.duration, event.thread,
+                     i + 1 < trace.size() ? "," : "");
+    }
+    std::fputs("],\"displayTimeUnit\":\"ms\"}\n", file);
+    return std::fclose(file) == 0;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Lightweight timing of named scopes. Time spent in each scope is summed per frame and kept for the last
+// PROFILE_HISTORY frames, and every single scope can optionally be recorded and saved in the Chrome trace event
+// format, to be opened in chrome://tracing or Perfetto.
+//
+// Each call site looks its series up once. Measurements then only go into the measuring thread's own totals, without
+// any lock, and are merged into the series when a frame is closed or the series are read. Only recording a trace
+// takes a lock per scope.
+
+const int PROFILE_HISTORY = 240;
+// Most distinct scope names. Scopes named past this are not timed.
+const int PROFILE_MAX_SITES = 128;
+
+// Per-frame time spent in a scope, in milliseconds, over the last frames.
+struct ProfileSeries
+{
+    const char* name;
+    std::array<float, PROFILE_HISTORY> frames{};
+    // Index of the oldest frame in frames.
+    int offset = 0;
+    float current = 0.0F;
+    int calls = 0;
+
+    float last() const
+    {
+        return frames[(offset + PROFILE_HISTORY - 1) % PROFILE_HISTORY];
+    }
+};
+
+class Profiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static Profiler& instance();
+
+    // Returns the id of the series with the given name, adding it if it is new, or -1 if there are too many. Names must
+    // be string literals, as they are kept by pointer. Takes a lock, so call sites look their id up once and keep it.
+    int site(const char* name);
+
+    // Adds a measurement to the current frame of a series, and to the trace if one is being recorded.
+    void record(int site, Clock::time_point start, Clock::time_point end);
+    // Same as above, looking the series up by name, for measurements outside of hot paths.
+    void record(const char* name, Clock::time_point start, Clock::time_point end);
+
+    // Closes the current frame, pushing the time spent in each scope into its history.
+    void endFrame();
+
+    // Copies the history of every scope seen so far.
+    std::vector<ProfileSeries> series();
+
+    void startTrace();
+    bool tracing();
+    // Stops recording and writes the recorded events to the given path as trace event JSON.
+    bool saveTrace(const std::string& path);
+
+private:
+    struct TraceEvent
+    {
+        int site;
+        int64_t start;
+        int64_t duration;
+        uint32_t thread;
+    };
+
+    // Totals of a single thread since it started, which only that thread writes. They only ever grow, so merging
+    // reads them while the thread keeps going, and remembers what it read to add only the difference next time.
+    struct ThreadTotals
+    {
+        std::array<std::atomic<int64_t>, PROFILE_MAX_SITES> nanos{};
+        std::array<std::atomic<int32_t>, PROFILE_MAX_SITES> calls{};
+        std::array<int64_t, PROFILE_MAX_SITES> mergedNanos{};
+        std::array<int32_t, PROFILE_MAX_SITES> mergedCalls{};
+
+        uint32_t thread = 0;
+        std::mutex traceMutex;
+        std::vector<TraceEvent> trace;
+    };
+
+    // Recording stops once this many events are recorded, to bound memory use.
+    static const std::size_t MAX_TRACE_EVENTS = 1 << 20;
+
+    ThreadTotals& threadTotals();
+    // Adds what every thread measured since the last merge to the current frame. Called with mMutex held.
+    void merge();
+
+    std::mutex mMutex;
+    std::vector<ProfileSeries> mSeries;
+    // Kept after their threads exit, so that what they measured is still merged.
+    std::vector<std::shared_ptr<ThreadTotals>> mThreads;
+    std::atomic<bool> mTracing{false};
+    std::atomic<std::size_t> mTraceEvents{0};
+    // Start of the trace, in clock ticks, which threads still recording may read while a new trace starts.
+    std::atomic<Clock::rep> mTraceStart{0};
+};
+
+// Measures the time until the end of the enclosing scope.
+struct ScopedTimer
+{
+    int site;
+    Profiler::Clock::time_point start = Profiler::Clock::now();
+
+    ~ScopedTimer()
+    {
+        Profiler::instance().record(site, start, Profiler::Clock::now());
+    }
+};
+
+#ifdef GAME_PROFILE_DISABLED
+#define PROFILE_SCOPE(name) ((void)0)
+#else
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name)                                                                                            \
+    static const int PROFILE_CONCAT(profileSite, __LINE__) = Profiler::instance().site(name);                         \
+    ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)                                                                 \
+    {                                                                                                                  \
+        PROFILE_CONCAT(profileSite, __LINE__)                                                                          \
+    }
+#endif
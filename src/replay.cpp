@@ -0,0 +1,139 @@
+#include "replay.hpp"
+
+#include "bytes.hpp"
+
+#include <algorithm>
+
+static const char RECORDING_MAGIC[4] = {'C', 'J', 'R', 'P'};
+static const uint8_t RECORDING_VERSION = 3;
+
+// Bits of the rules byte.
+static const uint8_t RECORDING_CASCADE_GRAVITY = 1;
+static const uint8_t RECORDING_CLEAR_ALL_AT_ONCE = 2;
+
+void startRecording(Recording& recording, const Game& game)
+{
+    recording.seed = game.seed;
+    recording.preset = game.board.preset;
+    recording.cascadeGravity = game.cascadeGravity;
+    recording.clearAllAtOnce = game.clearAllAtOnce;
+    recording.ticksToLock = game.ticksToLock;
+    recording.inputs.clear();
+}
+
+void recordInput(Recording& recording, const Game& game, Action action)
+{
+    recording.inputs.push_back({uint32_t(game.tick), uint8_t(action)});
+}
+
+bool saveRecording(const Recording& recording, const std::string& path)
+{
+    std::vector<uint8_t> data(RECORDING_MAGIC, RECORDING_MAGIC + 4);
+    data.push_back(RECORDING_VERSION);
+    writeLE(data, recording.seed, 8);
+    data.push_back(uint8_t(recording.preset));
+    data.push_back(uint8_t((recording.cascadeGravity ? RECORDING_CASCADE_GRAVITY : 0) |
+                           (recording.clearAllAtOnce ? RECORDING_CLEAR_ALL_AT_ONCE : 0)));
+    data.push_back(uint8_t(recording.ticksToLock));
+    writeLE(data, recording.inputs.size(), 4);
+
+    uint32_t lastTick = 0;
+    for (const auto& input : recording.inputs)
+    {
+        writeVarint(data, input.tick - lastTick);
+        data.push_back(input.action);
+        lastTick = input.tick;
+    }
+
+    return writeFile(path, data);
+}
+
+bool loadRecording(const std::string& path, Recording& recording)
+{
+    std::vector<uint8_t> data;
+    if (!readFile(path, data))
+    {
+        return false;
+    }
+
+    if (data.size() < 5 || !std::equal(RECORDING_MAGIC, RECORDING_MAGIC + 4, data.begin()) || data[4] < 1 ||
+        data[4] > RECORDING_VERSION)
+    {
+        return false;
+    }
+    int version = data[4];
+    const std::size_t headerSize = 4 + 1 + 8 + (version >= 2 ? 1 : 0) + (version >= 3 ? 2 : 0) + 4;
+    if (data.size() < headerSize)
+    {
+        return false;
+    }
+
+    recording.seed = readLE(&data[5], 8);
+    recording.preset = BOARD_CLASSIC;
+    if (version >= 2)
+    {
+        if (data[13] >= BOARD_PRESET_COUNT)
+        {
+            return false;
+        }
+        recording.preset = BoardPreset(data[13]);
+    }
+    recording.cascadeGravity = false;
+    recording.clearAllAtOnce = false;
+    recording.ticksToLock = Game{}.ticksToLock;
+    if (version >= 3)
+    {
+        if ((data[14] & ~(RECORDING_CASCADE_GRAVITY | RECORDING_CLEAR_ALL_AT_ONCE)) != 0)
+        {
+            return false;
+        }
+        recording.cascadeGravity = (data[14] & RECORDING_CASCADE_GRAVITY) != 0;
+        recording.clearAllAtOnce = (data[14] & RECORDING_CLEAR_ALL_AT_ONCE) != 0;
+        recording.ticksToLock = data[15];
+    }
+    // Each input takes at least two bytes, a tick delta and an action, so a larger count can only come from a corrupt
+    // file, and must not be reserved.
+    uint32_t count = uint32_t(readLE(&data[headerSize - 4], 4));
+    if (count > (data.size() - headerSize) / 2)
+    {
+        return false;
+    }
+    recording.inputs.clear();
+    recording.inputs.reserve(count);
+
+    std::size_t pos = headerSize;
+    uint32_t tick = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t delta;
+        if (!readVarint(data, pos, delta) || pos >= data.size() || data[pos] >= ACTION_COUNT)
+        {
+            return false;
+        }
+        tick += delta;
+        recording.inputs.push_back({tick, data[pos++]});
+    }
+    return true;
+}
+
+void startReplay(Replay& replay, const Recording& recording, Game& game)
+{
+    replay.next = 0;
+    game = Game{};
+    game.board = Board(recording.preset);
+    game.cascadeGravity = recording.cascadeGravity;
+    game.clearAllAtOnce = recording.clearAllAtOnce;
+    game.ticksToLock = recording.ticksToLock;
+    seedGame(game, recording.seed);
+}
+
+void stepReplay(Replay& replay, const Recording& recording, Game& game)
+{
+    const auto& inputs = recording.inputs;
+    while (replay.next < inputs.size() && inputs[replay.next].tick <= uint32_t(game.tick))
+    {
+        applyAction(game, Action(inputs[replay.next].action));
+        replay.next++;
+    }
+    tickGame(game);
+}
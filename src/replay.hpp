@@ -0,0 +1,57 @@
+#pragma once
+
+#include "game.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// An input, stamped with the number of ticks the game had run when it was applied.
+struct RecordedInput
+{
+    uint32_t tick;
+    uint8_t action;
+};
+
+// Everything needed to reproduce a game: its seed, board size, the rules which change the logic and the inputs applied
+// to it, in order.
+struct Recording
+{
+    uint64_t seed = 0;
+    BoardPreset preset = BOARD_CLASSIC;
+    bool cascadeGravity = false;
+    bool clearAllAtOnce = false;
+    int ticksToLock = Game{}.ticksToLock;
+    std::vector<RecordedInput> inputs{};
+};
+
+// Empties the recording, and takes the seed, board size and rules of the game, which should have just been seeded.
+void startRecording(Recording& recording, const Game& game);
+
+// Adds an action applied to the game to the end of the recording.
+void recordInput(Recording& recording, const Game& game, Action action);
+
+// Saves and loads recordings in a compact binary format: a header with the seed, board preset, rules and input count,
+// followed by each input as a variable length tick delta and an action byte. Version 1 recordings, which predate board
+// presets, load as classic boards, and versions before 3, which predate the rules, load with the default ones.
+bool saveRecording(const Recording& recording, const std::string& path);
+bool loadRecording(const std::string& path, Recording& recording);
+
+// Position of a replay in the recording it plays back through the rules. The recording is passed to every call, rather
+// than kept here, so that both can live in a component which moves.
+struct Replay
+{
+    std::size_t next = 0;
+
+    bool finished(const Recording& recording) const
+    {
+        return next >= recording.inputs.size();
+    }
+};
+
+// Resets the game to the recording's seed, board size and rules, and rewinds the replay.
+void startReplay(Replay& replay, const Recording& recording, Game& game);
+
+// Applies the recorded inputs due before the next tick, and then runs it.
+void stepReplay(Replay& replay, const Recording& recording, Game& game);
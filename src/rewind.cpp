@@ -0,0 +1,251 @@
+#include "rewind.hpp"
+
+#include "profiler.hpp"
+#include "snapshot.hpp"
+
+#include <algorithm>
+
+static RewindTickState tickState(const Game& game)
+{
+    return {game.tick,
+            game.rngState,
+            game.score,
+            game.pieces,
+            game.lines,
+            game.boardGen,
+            game.tickLockAccumulator,
+            game.gameOver,
+            uint8_t(game.floatingPieceColor),
+            uint8_t(game.pieceType),
+            uint8_t(game.pieceOrientation),
+            int8_t(game.pieceX),
+            int8_t(game.pieceY),
+            int8_t(game.pieceZ)};
+}
+
+static RewindChunk& chunkAt(RewindBuffer& buffer, std::size_t i)
+{
+    return buffer.chunks[(buffer.first + i) % buffer.chunks.size()];
+}
+
+static const RewindChunk& chunkAt(const RewindBuffer& buffer, std::size_t i)
+{
+    return buffer.chunks[(buffer.first + i) % buffer.chunks.size()];
+}
+
+static int lastTick(const RewindChunk& chunk)
+{
+    return chunk.firstTick + int(chunk.ticks.size());
+}
+
+void resetRewind(RewindBuffer& buffer, int capacity, int keyframeInterval)
+{
+    buffer.capacity = std::max(capacity, 1);
+    buffer.keyframeInterval = std::max(keyframeInterval, 1);
+    // One more chunk than needed, so that a full capacity is still kept while the newest chunk fills up.
+    buffer.chunks.assign(std::size_t((buffer.capacity + buffer.keyframeInterval - 1) / buffer.keyframeInterval + 1),
+                         RewindChunk{});
+    buffer.first = 0;
+    buffer.count = 0;
+}
+
+void clearRewind(RewindBuffer& buffer)
+{
+    buffer.first = 0;
+    buffer.count = 0;
+}
+
+// Adds the cell to the tick's changes if its color differs from the last recorded board.
+static void diffCell(RewindBuffer& buffer, RewindChunk& chunk, const Board& board, int cell)
+{
+    uint8_t color = board.colors[std::size_t(cell)];
+    if (color != buffer.last.colors[std::size_t(cell)])
+    {
+        int x, y, z;
+        chunk.cells.push_back({uint16_t(cell), color});
+        buffer.last.cellCoords(cell, x, y, z);
+        buffer.last.set(x, y, z, color);
+    }
+}
+
+void recordRewind(RewindBuffer& buffer, const Game& game)
+{
+    PROFILE_SCOPE("rewind: record");
+
+    if (buffer.chunks.empty())
+    {
+        resetRewind(buffer, buffer.capacity, buffer.keyframeInterval);
+    }
+
+    // A tick at or before the latest one means the game was rewound, so the future it had is gone. The board it is
+    // diffed against is then also gone, so the history carries on from a new keyframe.
+    bool truncated = false;
+    while (buffer.count > 0 && chunkAt(buffer, buffer.count - 1).firstTick >= game.tick)
+    {
+        buffer.count--;
+        truncated = true;
+    }
+    if (buffer.count > 0)
+    {
+        RewindChunk& chunk = chunkAt(buffer, buffer.count - 1);
+        if (lastTick(chunk) >= game.tick)
+        {
+            auto keep = std::size_t(game.tick - 1 - chunk.firstTick);
+            chunk.ticks.resize(keep);
+            chunk.cellsEnd.resize(keep);
+            chunk.cells.resize(keep == 0 ? 0 : chunk.cellsEnd.back());
+            truncated = true;
+        }
+    }
+
+    bool contiguous = buffer.count > 0 && lastTick(chunkAt(buffer, buffer.count - 1)) + 1 == game.tick &&
+                      buffer.last.preset == game.board.preset;
+    if (contiguous && !truncated &&
+        int(chunkAt(buffer, buffer.count - 1).ticks.size()) + 1 < buffer.keyframeInterval)
+    {
+        RewindChunk& chunk = chunkAt(buffer, buffer.count - 1);
+        if (buffer.fullDiff)
+        {
+            for (int cell = 0; cell < game.board.cellCount(); cell++)
+            {
+                diffCell(buffer, chunk, game.board, cell);
+            }
+        }
+        else
+        {
+            // Cells marked before the last recorded tick, if nothing cleared them since, already match and add nothing.
+            for (int cell : game.board.dirtyCells)
+            {
+                diffCell(buffer, chunk, game.board, cell);
+            }
+        }
+        chunk.ticks.push_back(tickState(game));
+        chunk.cellsEnd.push_back(uint32_t(chunk.cells.size()));
+        buffer.last.clearDirty();
+        buffer.fullDiff = false;
+        return;
+    }
+
+    // Start a new chunk, dropping the oldest if every chunk is in use. Gaps in the ticks, which only happen if the
+    // game was replaced, also start a new chunk, as the deltas would be meaningless across them.
+    if (!contiguous)
+    {
+        buffer.count = 0;
+    }
+    if (buffer.count == buffer.chunks.size())
+    {
+        buffer.first = (buffer.first + 1) % buffer.chunks.size();
+        buffer.count--;
+    }
+    RewindChunk& chunk = chunkAt(buffer, buffer.count++);
+    saveSnapshot(game, chunk.keyframe);
+    chunk.firstTick = game.tick;
+    chunk.ticks.clear();
+    chunk.cellsEnd.clear();
+    chunk.cells.clear();
+    buffer.last = game.board;
+    buffer.last.clearDirty();
+    buffer.fullDiff = true;
+}
+
+int oldestRewindTick(const RewindBuffer& buffer)
+{
+    return chunkAt(buffer, 0).firstTick;
+}
+
+int latestRewindTick(const RewindBuffer& buffer)
+{
+    return lastTick(chunkAt(buffer, buffer.count - 1));
+}
+
+bool rewindTo(const RewindBuffer& buffer, int tick, Game& game)
+{
+    PROFILE_SCOPE("rewind: restore");
+
+    for (std::size_t i = 0; i < buffer.count; i++)
+    {
+        const RewindChunk& chunk = chunkAt(buffer, i);
+        if (tick < chunk.firstTick || tick > lastTick(chunk))
+        {
+            continue;
+        }
+
+        Game restored;
+        if (!loadSnapshot(chunk.keyframe, restored))
+        {
+            return false;
+        }
+        restored.board.clearDirty();
+
+        int deltas = tick - chunk.firstTick;
+        int x, y, z;
+        for (uint32_t c = 0; deltas > 0 && c < chunk.cellsEnd[std::size_t(deltas - 1)]; c++)
+        {
+            restored.board.cellCoords(chunk.cells[c].cell, x, y, z);
+            restored.board.set(x, y, z, chunk.cells[c].color);
+        }
+        if (deltas > 0)
+        {
+            const RewindTickState& state = chunk.ticks[std::size_t(deltas - 1)];
+            restored.tick = state.tick;
+            restored.rngState = state.rngState;
+            restored.score = state.score;
+            restored.pieces = state.pieces;
+            restored.lines = state.lines;
+            restored.boardGen = state.boardGen;
+            restored.tickLockAccumulator = state.tickLockAccumulator;
+            restored.gameOver = state.gameOver;
+            restored.floatingPieceColor = state.floatingPieceColor;
+            restored.pieceType = state.pieceType;
+            restored.pieceOrientation = state.pieceOrientation;
+            restored.pieceX = state.pieceX;
+            restored.pieceY = state.pieceY;
+            restored.pieceZ = state.pieceZ;
+
+            restored.blockX.clear();
+            restored.blockY.clear();
+            restored.blockZ.clear();
+            if (restored.floatingPieceColor != 0)
+            {
+                for (const auto& block : PIECES.orientations[restored.pieceType][restored.pieceOrientation])
+                {
+                    restored.blockX.push_back(restored.pieceX + block.x);
+                    restored.blockY.push_back(restored.pieceY + block.y);
+                    restored.blockZ.push_back(restored.pieceZ + block.z);
+                }
+            }
+        }
+
+        // Settings which aren't part of the history stay as they are.
+        restored.tickAccumulator = game.tickAccumulator;
+        restored.tickPeriod = game.tickPeriod;
+        restored.ticksToLock = game.ticksToLock;
+        restored.maxCatchUpTicks = game.maxCatchUpTicks;
+        restored.clearAllAtOnce = game.clearAllAtOnce;
+        restored.cascadeGravity = game.cascadeGravity;
+        restored.board.clearDirty();
+        if (restored.board.preset == game.board.preset)
+        {
+            restored.board.markChangedFrom(game.board);
+        }
+        else
+        {
+            restored.board.markAllDirty();
+        }
+        restored.events = PIECE_SPAWNED;
+        game = std::move(restored);
+        return true;
+    }
+    return false;
+}
+
+std::size_t rewindMemory(const RewindBuffer& buffer)
+{
+    std::size_t bytes = 0;
+    for (const auto& chunk : buffer.chunks)
+    {
+        bytes += chunk.keyframe.capacity() + chunk.ticks.capacity() * sizeof(RewindTickState) +
+                 chunk.cellsEnd.capacity() * sizeof(uint32_t) + chunk.cells.capacity() * sizeof(RewindCellChange);
+    }
+    return bytes;
+}
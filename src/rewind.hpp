@@ -0,0 +1,89 @@
+#pragma once
+
+#include "game.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A cell which changed on a tick, and its new color.
+struct RewindCellChange
+{
+    uint16_t cell;
+    uint8_t color;
+};
+
+// Everything in a game which changes from tick to tick, other than the board.
+struct RewindTickState
+{
+    int tick;
+    uint64_t rngState;
+    int score;
+    int pieces;
+    int lines;
+    int boardGen;
+    int tickLockAccumulator;
+    bool gameOver;
+    uint8_t floatingPieceColor;
+    uint8_t pieceType;
+    uint8_t pieceOrientation;
+    int8_t pieceX;
+    int8_t pieceY;
+    int8_t pieceZ;
+};
+
+struct RewindChunk
+{
+    std::vector<uint8_t> keyframe{};
+    int firstTick = 0;
+    // Delta of each tick after the keyframe, with the end of its cell changes in cells.
+    std::vector<RewindTickState> ticks{};
+    std::vector<uint32_t> cellsEnd{};
+    std::vector<RewindCellChange> cells{};
+};
+
+// Bounded history of the last ticks of a game, which it can be rewound to exactly. The history is split into chunks,
+// each starting with a keyframe, the snapshot of the game at that tick, followed by a delta for each later tick: the
+// cells which changed and the small state of the piece and counters. Restoring a tick loads the keyframe before it and
+// replays the deltas up to it, so it costs at most one chunk of deltas. The oldest chunk is dropped as a whole once
+// the history is full, which keeps memory at a few kilobytes per chunk.
+struct RewindBuffer
+{
+    // Ticks per chunk, including the keyframe.
+    int keyframeInterval = 64;
+    // At least this many of the latest ticks are kept.
+    int capacity = 1000;
+
+    // Ring of chunks, where the oldest is at first. Chunks keep their storage when reused.
+    std::vector<RewindChunk> chunks{};
+    std::size_t first = 0;
+    std::size_t count = 0;
+
+    // The board as of the last recorded tick, which the next tick is diffed against.
+    Board last{};
+    // Ticks are diffed through the board's dirty cells, which must then cover every cell changed since the last
+    // recorded tick. The first tick after a keyframe, and any after the game was replaced without a tick, such as by
+    // loading a snapshot, are diffed against the whole board instead.
+    bool fullDiff = true;
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+};
+
+// Sets how many ticks the history keeps, and forgets it.
+void resetRewind(RewindBuffer& buffer, int capacity, int keyframeInterval = 64);
+// Forgets the history, keeping its storage.
+void clearRewind(RewindBuffer& buffer);
+// Records the state of the game after its latest tick. If the game was rewound, every tick after it is forgotten. Set
+// fullDiff before recording if the board changed since the last tick without its cells being marked dirty.
+void recordRewind(RewindBuffer& buffer, const Game& game);
+// Oldest and latest ticks which can be restored. Only valid if the buffer isn't empty.
+int oldestRewindTick(const RewindBuffer& buffer);
+int latestRewindTick(const RewindBuffer& buffer);
+// Restores the game to how it was after the given tick. Returns false, leaving it alone, if the tick isn't in the
+// history. Cells which differ from the current board are marked dirty, and the piece as spawned.
+bool rewindTo(const RewindBuffer& buffer, int tick, Game& game);
+// Bytes used by the recorded history.
+std::size_t rewindMemory(const RewindBuffer& buffer);
@@ -0,0 +1,99 @@
+#include "rewindTool.hpp"
+
+#include "gameLogic.hpp"
+#include "profiler.hpp"
+
+#include <cubos/engine/imgui/plugin.hpp>
+#include <cubos/engine/input/plugin.hpp>
+#include <cubos/engine/tools/toolbox/plugin.hpp>
+
+#include <imgui.h>
+
+using namespace cubos::engine;
+
+// Shows the history of a board as a scrubber.
+static void showRewindWindow(Game& game, GameHistory& history, GameRecorder& recorder, Autoplay& autoplay)
+{
+    ImGui::Begin("Rewind");
+    if (recorder.isReplaying() || history.buffer.empty())
+    {
+        ImGui::TextUnformatted("No history yet");
+        ImGui::End();
+        return;
+    }
+
+    int oldest = oldestRewindTick(history.buffer);
+    int latest = latestRewindTick(history.buffer);
+    int tick = game.tick;
+    if (ImGui::SliderInt("Tick", &tick, oldest, latest))
+    {
+        showHistoryTick(history, game, tick);
+    }
+    if (!history.paused)
+    {
+        if (ImGui::Button("Pause"))
+        {
+            showHistoryTick(history, game, game.tick);
+        }
+    }
+    else if (ImGui::Button("Resume"))
+    {
+        resumeFromHistory(history, game, recorder, autoplay);
+    }
+    ImGui::SameLine();
+    ImGui::Text("%d ticks in %zu chunks, %.1f KiB", latest - oldest + 1, history.buffer.count,
+                double(rewindMemory(history.buffer)) / 1024.0);
+
+    ImGui::End();
+}
+
+void rewindToolPlugin(Cubos& cubos)
+{
+    cubos.depends(imguiPlugin);
+    cubos.depends(inputPlugin);
+    cubos.depends(toolboxPlugin);
+    cubos.depends(gameLogicPlugin);
+
+    cubos.system("step through the history on input")
+        .before(gameLogicTag)
+        .call([](const Input& input, Query<const GameBoard&, Game&, GameHistory&, GameRecorder&, Autoplay&> boards) {
+            PROFILE_SCOPE("step through the history on input");
+
+            for (auto [board, game, history, recorder, autoplay] : boards)
+            {
+                if (!board.local || recorder.isReplaying() || history.buffer.empty())
+                {
+                    continue;
+                }
+                if (input.justPressed("step-back"))
+                {
+                    showHistoryTick(history, game, history.paused ? game.tick - 1 : game.tick);
+                }
+                if (input.justPressed("step-forward") && history.paused)
+                {
+                    showHistoryTick(history, game, game.tick + 1);
+                }
+                if (input.justPressed("resume") && history.paused)
+                {
+                    resumeFromHistory(history, game, recorder, autoplay);
+                }
+            }
+        });
+
+    cubos.system("show rewind tool")
+        .tagged(imguiTag)
+        .call([](Toolbox& toolbox, Query<const GameBoard&, Game&, GameHistory&, GameRecorder&, Autoplay&> boards) {
+            if (!toolbox.isOpen("Rewind"))
+            {
+                return;
+            }
+
+            for (auto [board, game, history, recorder, autoplay] : boards)
+            {
+                if (board.local)
+                {
+                    showRewindWindow(game, history, recorder, autoplay);
+                }
+            }
+        });
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cubos/engine/prelude.hpp>
+
+// Steps the local board's game back and forth through its history with the "step-back" and "step-forward" input
+// actions, which pause it until "resume". The "Rewind" tool shows the history as a scrubber.
+void rewindToolPlugin(cubos::engine::Cubos& cubos);
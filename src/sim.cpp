@@ -0,0 +1,603 @@
+// Headless simulation of the game rules, for measuring logic throughput without a window or renderer.
+//
+// Usage: game_sim [--ticks N] [--seed S] [--board small|classic|huge] [--policy none|random|script|bot]
+//                 [--script ACTIONS] [--tick-period SECONDS] [--ticks-to-lock N] [--gravity column|cascade]
+//                 [--record FILE] [--replay FILE] [--trace FILE]
+//        game_sim --games N [--seed S] [--ticks N] [--board SIZE] [--policy none|random|bot] [--threads N]
+//                 [--tick-period SECONDS] [--ticks-to-lock N] [--gravity column|cascade]
+//        game_sim --versus 0|1 --port P --peer-port Q [--peer-host ADDRESS] [--input-delay N] [--rollback N]
+//                 [--seed S] [--ticks N] [--board SIZE] [--policy none|random|script|bot] [--script ACTIONS]
+//
+// The script policy cycles through ACTIONS, one character per tick: N, E, S and W move the piece in that direction,
+// X, Y and Z turn it clockwise around that axis, D hard drops it, and any other character does nothing. The bot policy
+// searches for the best placement of each piece as it spawns, using every core, and the none policy never moves the
+// pieces, which only fall. With cascade gravity, blocks left hanging by a clear fall as whole groups, instead of each
+// column above it moving down.
+//
+// With --record, only the first game is simulated and its inputs are saved to FILE. With --replay, the recording in
+// FILE is played back, on the board and with the rules it was recorded with, instead of running a policy, until the
+// game ends or the tick limit is reached. With --trace, every profiled logic phase is saved to FILE as a Chrome trace.
+//
+// With --games, N independent games are played in parallel across every core (or --threads of them), seeded S,
+// S + 1 and so on, each until it ends or reaches --ticks. Their score distribution, length, lines per piece and time
+// per tick are printed, along with the seeds of any games which broke an invariant.
+//
+// With --versus, this process plays one side of a two player match against another game_sim on the peer address
+// (127.0.0.1 by default), exchanging only inputs over UDP. Both must be given the same seed and board. The match runs
+// as fast as the inputs arrive, until one side tops out or --ticks ticks are confirmed, and then prints the traffic,
+// the rollbacks and the hash of the final state, which is the same on both sides unless they desynced.
+
+#include "batch.hpp"
+#include "bot.hpp"
+#include "game.hpp"
+#include "profiler.hpp"
+#include "replay.hpp"
+#include "udpSocket.hpp"
+#include "versus.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+
+struct Options
+{
+    long long ticks = 1000000;
+    uint64_t seed = 1;
+    bool scripted = false;
+    bool bot = false;
+    std::string script = "N.E..S.W..";
+    std::string recordPath{};
+    std::string replayPath{};
+    std::string tracePath{};
+
+    int games = 0;
+    unsigned threads = 0;
+    BatchOptions batch{};
+
+    int versusSide = -1;
+    uint16_t port = 0;
+    uint16_t peerPort = 0;
+    std::string peerHost = "127.0.0.1";
+    int inputDelay = 3;
+    int rollback = 8;
+};
+
+struct Totals
+{
+    long long ticks = 0;
+    long long games = 0;
+    long long pieces = 0;
+    long long lines = 0;
+
+    void add(const Game& game)
+    {
+        games++;
+        pieces += game.pieces;
+        lines += game.lines;
+    }
+};
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr)
+        {
+            std::fprintf(stderr, "Missing value for %s\n", arg);
+            return false;
+        }
+
+        if (std::strcmp(arg, "--ticks") == 0)
+        {
+            options.ticks = std::atoll(value);
+        }
+        else if (std::strcmp(arg, "--seed") == 0)
+        {
+            options.seed = std::strtoull(value, nullptr, 10);
+        }
+        else if (std::strcmp(arg, "--policy") == 0)
+        {
+            if (std::strcmp(value, "none") != 0 && std::strcmp(value, "random") != 0 &&
+                std::strcmp(value, "script") != 0 && std::strcmp(value, "bot") != 0)
+            {
+                std::fprintf(stderr, "Unknown policy %s\n", value);
+                return false;
+            }
+            options.scripted = std::strcmp(value, "script") == 0;
+            options.bot = std::strcmp(value, "bot") == 0;
+            options.batch.policy = options.bot                         ? BATCH_POLICY_BOT
+                                   : std::strcmp(value, "none") == 0 ? BATCH_POLICY_NONE
+                                                                      : BATCH_POLICY_RANDOM;
+        }
+        else if (std::strcmp(arg, "--board") == 0)
+        {
+            if (!parseBoardPreset(value, options.batch.preset))
+            {
+                std::fprintf(stderr, "Unknown board size %s\n", value);
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--gravity") == 0)
+        {
+            if (std::strcmp(value, "cascade") != 0 && std::strcmp(value, "column") != 0)
+            {
+                std::fprintf(stderr, "Unknown gravity %s\n", value);
+                return false;
+            }
+            options.batch.cascadeGravity = std::strcmp(value, "cascade") == 0;
+        }
+        else if (std::strcmp(arg, "--games") == 0)
+        {
+            options.games = std::atoi(value);
+        }
+        else if (std::strcmp(arg, "--threads") == 0)
+        {
+            options.threads = unsigned(std::atoi(value));
+        }
+        else if (std::strcmp(arg, "--tick-period") == 0)
+        {
+            options.batch.tickPeriod = float(std::atof(value));
+        }
+        else if (std::strcmp(arg, "--ticks-to-lock") == 0)
+        {
+            options.batch.ticksToLock = std::atoi(value);
+        }
+        else if (std::strcmp(arg, "--versus") == 0)
+        {
+            options.versusSide = std::atoi(value);
+            if (options.versusSide != 0 && options.versusSide != 1)
+            {
+                std::fprintf(stderr, "The versus side must be 0 or 1\n");
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--port") == 0)
+        {
+            options.port = uint16_t(std::atoi(value));
+        }
+        else if (std::strcmp(arg, "--peer-port") == 0)
+        {
+            options.peerPort = uint16_t(std::atoi(value));
+        }
+        else if (std::strcmp(arg, "--peer-host") == 0)
+        {
+            options.peerHost = value;
+        }
+        else if (std::strcmp(arg, "--input-delay") == 0)
+        {
+            options.inputDelay = std::atoi(value);
+        }
+        else if (std::strcmp(arg, "--rollback") == 0)
+        {
+            options.rollback = std::atoi(value);
+        }
+        else if (std::strcmp(arg, "--script") == 0)
+        {
+            options.script = value;
+        }
+        else if (std::strcmp(arg, "--record") == 0)
+        {
+            options.recordPath = value;
+        }
+        else if (std::strcmp(arg, "--replay") == 0)
+        {
+            options.replayPath = value;
+        }
+        else if (std::strcmp(arg, "--trace") == 0)
+        {
+            options.tracePath = value;
+        }
+        else
+        {
+            std::fprintf(stderr, "Unknown option %s\n", arg);
+            return false;
+        }
+        i++;
+    }
+    if (options.games > 0 && options.scripted)
+    {
+        std::fprintf(stderr, "The script policy can't be used with --games\n");
+        return false;
+    }
+    return !options.script.empty();
+}
+
+// Picks the input of the given tick, or returns false if there is none.
+static bool pickAction(const Options& options, long long tick, std::mt19937& rng, Action& action)
+{
+    char key;
+    if (options.batch.policy == BATCH_POLICY_NONE)
+    {
+        return false;
+    }
+    if (options.scripted)
+    {
+        key = options.script[std::size_t(tick % (long long)options.script.size())];
+    }
+    else
+    {
+        // Move on roughly half the ticks, like a player nudging the piece around as it falls.
+        key = "NESW...."[rng() % 8];
+    }
+
+    switch (key)
+    {
+    case 'N':
+        action = ACTION_MOVE_NORTH;
+        return true;
+    case 'E':
+        action = ACTION_MOVE_EAST;
+        return true;
+    case 'S':
+        action = ACTION_MOVE_SOUTH;
+        return true;
+    case 'W':
+        action = ACTION_MOVE_WEST;
+        return true;
+    case 'X':
+        action = ACTION_ROTATE_X_CW;
+        return true;
+    case 'Y':
+        action = ACTION_ROTATE_Y_CW;
+        return true;
+    case 'Z':
+        action = ACTION_ROTATE_Z_CW;
+        return true;
+    case 'D':
+        action = ACTION_HARD_DROP;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Resets the game to a new one with the board and rules of the options.
+static void startGame(const Options& options, uint64_t seed, Game& game)
+{
+    game = Game{};
+    game.tickPeriod = options.batch.tickPeriod;
+    game.ticksToLock = options.batch.ticksToLock;
+    game.cascadeGravity = options.batch.cascadeGravity;
+    game.board = Board(options.batch.preset);
+    seedGame(game, seed);
+}
+
+static void simulate(const Options& options, Totals& totals)
+{
+    std::mt19937 rng(uint32_t(options.seed));
+    Recording recording;
+
+    Bot bot;
+    BotPlan plan;
+
+    Game game;
+    startGame(options, options.seed, game);
+    startRecording(recording, game);
+
+    for (; totals.ticks < options.ticks; totals.ticks++)
+    {
+        Action action;
+        if (options.bot)
+        {
+            if (botPlan(bot, game, &ThreadPool::shared(), plan))
+            {
+                for (Action planned : plan.actions)
+                {
+                    applyAction(game, planned);
+                    if (!options.recordPath.empty())
+                    {
+                        recordInput(recording, game, planned);
+                    }
+                }
+            }
+        }
+        else if (pickAction(options, totals.ticks, rng, action))
+        {
+            applyAction(game, action);
+            if (!options.recordPath.empty())
+            {
+                recordInput(recording, game, action);
+            }
+        }
+        tickGame(game);
+
+        if (game.gameOver)
+        {
+            totals.add(game);
+            if (!options.recordPath.empty())
+            {
+                totals.ticks++;
+                break;
+            }
+
+            // Each game gets its own seed, so that runs with the same options are identical.
+            startGame(options, game.seed + 1, game);
+            bot.plannedPiece = -1;
+        }
+    }
+
+    if (!game.gameOver)
+    {
+        totals.add(game);
+    }
+
+    if (!options.recordPath.empty())
+    {
+        if (!saveRecording(recording, options.recordPath))
+        {
+            std::fprintf(stderr, "Could not save recording to %s\n", options.recordPath.c_str());
+        }
+        std::printf("recorded:   %zu inputs to %s\n", recording.inputs.size(), options.recordPath.c_str());
+    }
+}
+
+static bool replay(const Options& options, Totals& totals)
+{
+    Recording recording;
+    if (!loadRecording(options.replayPath, recording))
+    {
+        std::fprintf(stderr, "Could not load recording from %s\n", options.replayPath.c_str());
+        return false;
+    }
+
+    Game game;
+    Replay replay;
+    startReplay(replay, recording, game);
+    for (; totals.ticks < options.ticks && !game.gameOver; totals.ticks++)
+    {
+        stepReplay(replay, recording, game);
+    }
+    totals.add(game);
+
+    std::printf("replayed:   %zu inputs, score %d\n", recording.inputs.size(), game.score);
+    return true;
+}
+
+static int batch(Options& options)
+{
+    options.batch.games = options.games;
+    options.batch.firstSeed = options.seed;
+    if (options.ticks < (long long)options.batch.maxTicks)
+    {
+        options.batch.maxTicks = int(options.ticks);
+    }
+
+    ThreadPool pool(options.threads);
+    BatchResult result = runBatch(options.batch, pool);
+
+    const char* RANKS = "min/p10/p50/p90/p99/max";
+    std::printf("games:         %d in %.3f s on %u threads (%.0f games/hour)\n", options.games, result.seconds,
+                pool.size(), double(options.games) / result.seconds * 3600.0);
+    std::printf("unfinished:    %d (stopped at %d ticks)\n", result.unfinished, options.batch.maxTicks);
+    std::printf("score:         mean %.1f, %s %d/%d/%d/%d/%d/%d\n", result.meanScore, RANKS,
+                result.scorePercentiles[0], result.scorePercentiles[1], result.scorePercentiles[2],
+                result.scorePercentiles[3], result.scorePercentiles[4], result.scorePercentiles[5]);
+    std::printf("ticks:         mean %.1f (%.1f s of game time), %s %d/%d/%d/%d/%d/%d\n", result.meanTicks,
+                result.meanTicks * double(options.batch.tickPeriod), RANKS, result.tickPercentiles[0],
+                result.tickPercentiles[1], result.tickPercentiles[2], result.tickPercentiles[3],
+                result.tickPercentiles[4], result.tickPercentiles[5]);
+    std::printf("lines/piece:   %.4f\n", result.linesPerPiece);
+    std::printf("time/tick:     %.1f ns\n", result.nanosPerTick);
+
+    std::printf("score histogram:\n");
+    for (std::size_t i = 0; i < result.scoreHistogram.size(); i++)
+    {
+        if (result.scoreHistogram[i] > 0)
+        {
+            std::printf("  %6d-%-6d %d\n", int(i) * result.scoreBucket, int(i + 1) * result.scoreBucket - 1,
+                        result.scoreHistogram[i]);
+        }
+    }
+
+    if (result.broken > 0)
+    {
+        std::printf("broken:        %d games, seeds:", result.broken);
+        for (const auto& game : result.games)
+        {
+            if (game.broken)
+            {
+                std::printf(" %llu", (unsigned long long)game.seed);
+            }
+        }
+        std::printf("\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int versus(const Options& options)
+{
+    using Clock = std::chrono::steady_clock;
+
+    UdpSocket socket;
+    if (!socket.open(options.port, options.peerHost, options.peerPort))
+    {
+        std::fprintf(stderr, "Could not open UDP port %u\n", unsigned(options.port));
+        return 1;
+    }
+
+    VersusSession session;
+    startVersusSession(session, options.versusSide, options.inputDelay, options.rollback, options.batch.preset,
+                       options.seed);
+    int lastTick = int(std::min(options.ticks, 1LL << 30));
+
+    // Each side gets its own random inputs.
+    std::mt19937 rng(uint32_t(options.seed) + uint32_t(options.versusSide));
+    Bot bot;
+    BotPlan plan;
+    VersusInput input;
+    std::vector<uint8_t> packet;
+
+    auto start = Clock::now();
+    auto heard = start;
+    auto finished = Clock::time_point{};
+    while (true)
+    {
+        bool progress = false;
+        while (socket.receive(packet))
+        {
+            if (readVersusPacket(session, packet))
+            {
+                heard = Clock::now();
+                progress = true;
+            }
+        }
+
+        while (session.winner == -1 && session.localTick < lastTick && versusWantsInput(session))
+        {
+            input.clear();
+            Action action;
+            if (options.bot)
+            {
+                // Planned on the predicted game, and applied input delay ticks later.
+                if (botPlan(bot, session.state.games[session.side], &ThreadPool::shared(), plan))
+                {
+                    for (Action planned : plan.actions)
+                    {
+                        input.push_back(uint8_t(planned));
+                    }
+                }
+            }
+            else if (pickAction(options, session.localTick, rng, action))
+            {
+                input.push_back(uint8_t(action));
+            }
+            addVersusInput(session, input);
+            progress = true;
+        }
+
+        progress = advanceVersus(session) > 0 || progress;
+        writeVersusPacket(session, packet);
+        socket.send(packet);
+
+        if (session.desyncTick != -1)
+        {
+            break;
+        }
+
+        // Once the match is over, keep sending until the peer has every input, so that it can finish it too.
+        auto now = Clock::now();
+        if (session.winner != -1 || confirmedVersusTick(session) >= lastTick)
+        {
+            if (finished == Clock::time_point{})
+            {
+                finished = now;
+            }
+            if (session.peerAck >= session.localTick || now - finished > std::chrono::seconds(2))
+            {
+                break;
+            }
+        }
+        else if (now - heard > std::chrono::seconds(10))
+        {
+            std::fprintf(stderr, "Nothing heard from %s:%u for 10 seconds\n", options.peerHost.c_str(),
+                         unsigned(options.peerPort));
+            return 1;
+        }
+
+        if (!progress)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    int ticks = session.resultTick != -1 ? session.resultTick : confirmedVersusTick(session);
+    std::printf("ticks:      %d confirmed in %.3f s\n", ticks, elapsed);
+    std::printf("packets:    %lld sent, %.1f bytes each, %.2f bytes/tick\n", session.packetsSent,
+                double(session.bytesSent) / double(std::max(session.packetsSent, 1LL)),
+                double(session.bytesSent) / double(std::max(ticks, 1)));
+    std::printf("rollbacks:  %d, %lld ticks simulated again\n", session.rollbacks, session.resimulatedTicks);
+    for (int player = 0; player < VERSUS_PLAYERS; player++)
+    {
+        const Game& game = session.state.games[player];
+        std::printf("player %d:   score %d, %d lines, %d garbage sent%s\n", player, game.score, game.lines,
+                    session.state.sentGarbage[player], player == session.side ? " (local)" : "");
+    }
+    if (session.winner == VERSUS_PLAYERS)
+    {
+        std::printf("result:     draw\n");
+    }
+    else if (session.winner != -1)
+    {
+        std::printf("result:     player %d wins on tick %d\n", session.winner, session.resultTick);
+    }
+    else
+    {
+        std::printf("result:     undecided\n");
+    }
+    if (session.hashedTick > 0)
+    {
+        std::printf("hash:       %08x after tick %d\n", session.hashes[(session.hashedTick - 1) % VERSUS_HISTORY],
+                    session.hashedTick);
+    }
+
+    if (session.desyncTick != -1)
+    {
+        std::printf("desync:     after tick %d\n", session.desyncTick);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+
+    if (options.games > 0)
+    {
+        return batch(options);
+    }
+    if (options.versusSide != -1)
+    {
+        return versus(options);
+    }
+
+    if (!options.tracePath.empty())
+    {
+        Profiler::instance().startTrace();
+    }
+
+    Totals totals;
+    auto start = std::chrono::steady_clock::now();
+    if (!options.replayPath.empty())
+    {
+        if (!replay(options, totals))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        simulate(options, totals);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("ticks:      %lld in %.3f s\n", totals.ticks, elapsed);
+    std::printf("games:      %lld\n", totals.games);
+    std::printf("ticks/sec:  %.0f\n", double(totals.ticks) / elapsed);
+    std::printf("pieces/sec: %.0f\n", double(totals.pieces) / elapsed);
+    std::printf("lines/sec:  %.0f\n", double(totals.lines) / elapsed);
+
+    // Frames are never closed here, so each series holds the total time of the whole run.
+    for (const auto& series : Profiler::instance().series())
+    {
+        std::printf("%-18s %.3f ms\n", series.name, double(series.current));
+    }
+    if (!options.tracePath.empty() && !Profiler::instance().saveTrace(options.tracePath))
+    {
+        std::fprintf(stderr, "Could not save trace to %s\n", options.tracePath.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,233 @@
+#include "snapshot.hpp"
+
+#include "bytes.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+static const char SNAPSHOT_MAGIC[4] = {'C', 'J', 'S', 'N'};
+static const uint8_t SNAPSHOT_VERSION = 1;
+// Magic, version, preset, tick, seed, rngState, score, pieces, lines, boardGen, tickAccumulator, tickPeriod,
+// ticksToLock, tickLockAccumulator, maxCatchUpTicks and flags.
+static const std::size_t SNAPSHOT_HEADER_SIZE = 4 + 1 + 1 + 4 + 8 + 8 + 4 + 4 + 4 + 4 + 4 + 4 + 1 + 1 + 1 + 1;
+
+static void writeFloat(std::vector<uint8_t>& out, float value)
+{
+    writeLE(out, std::bit_cast<uint32_t>(value), 4);
+}
+
+static float readFloat(const uint8_t* in)
+{
+    return std::bit_cast<float>(uint32_t(readLE(in, 4)));
+}
+
+void saveSnapshot(const Game& game, std::vector<uint8_t>& data)
+{
+    PROFILE_SCOPE("snapshot: save");
+
+    const Board& board = game.board;
+    data.assign(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 4);
+    data.push_back(SNAPSHOT_VERSION);
+    data.push_back(uint8_t(board.preset));
+    writeLE(data, uint32_t(game.tick), 4);
+    writeLE(data, game.seed, 8);
+    writeLE(data, game.rngState, 8);
+    writeLE(data, uint32_t(game.score), 4);
+    writeLE(data, uint32_t(game.pieces), 4);
+    writeLE(data, uint32_t(game.lines), 4);
+    writeLE(data, uint32_t(game.boardGen), 4);
+    writeFloat(data, game.tickAccumulator);
+    writeFloat(data, game.tickPeriod);
+    data.push_back(uint8_t(game.ticksToLock));
+    data.push_back(uint8_t(game.tickLockAccumulator));
+    data.push_back(uint8_t(game.maxCatchUpTicks));
+    data.push_back(uint8_t((game.gameOver ? 1 : 0) | (game.clearAllAtOnce ? 2 : 0) | (game.cascadeGravity ? 4 : 0)));
+
+    data.push_back(uint8_t(game.floatingPieceColor));
+    if (game.floatingPieceColor != 0)
+    {
+        data.push_back(uint8_t(game.pieceType << 5 | game.pieceOrientation));
+        data.push_back(uint8_t(game.pieceX));
+        data.push_back(uint8_t(game.pieceY));
+        data.push_back(uint8_t(game.pieceZ));
+    }
+
+    // Rows are at most 16 bits wide, so the bits of each row are shifted in below whatever is left of the previous.
+    uint32_t bits = 0;
+    int bitCount = 0;
+    for (BoardRow row : board.rows)
+    {
+        bits |= uint32_t(row) << bitCount;
+        for (bitCount += board.width; bitCount >= 8; bitCount -= 8)
+        {
+            data.push_back(uint8_t(bits));
+            bits >>= 8;
+        }
+    }
+    if (bitCount > 0)
+    {
+        data.push_back(uint8_t(bits));
+    }
+
+    uint8_t runColor = 0;
+    uint32_t runLength = 0;
+    for (int rowIndex = 0; rowIndex < int(board.rows.size()); rowIndex++)
+    {
+        for (BoardRow row = board.rows[rowIndex]; row != 0; row &= BoardRow(row - 1))
+        {
+            uint8_t color = board.colors[std::size_t(rowIndex * board.width + std::countr_zero(row))];
+            if (color != runColor && runLength > 0)
+            {
+                writeVarint(data, runLength);
+                data.push_back(runColor);
+                runLength = 0;
+            }
+            runColor = color;
+            runLength++;
+        }
+    }
+    if (runLength > 0)
+    {
+        writeVarint(data, runLength);
+        data.push_back(runColor);
+    }
+
+    writeLE(data, fnv1a(data.data(), data.size()), 4);
+}
+
+bool loadSnapshot(const std::vector<uint8_t>& data, Game& game)
+{
+    PROFILE_SCOPE("snapshot: load");
+
+    if (data.size() < SNAPSHOT_HEADER_SIZE + 1 + 4 || !std::equal(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 4, data.begin()) ||
+        data[4] != SNAPSHOT_VERSION || data[5] >= BOARD_PRESET_COUNT)
+    {
+        return false;
+    }
+    std::size_t end = data.size() - 4;
+    if (uint32_t(readLE(&data[end], 4)) != fnv1a(data.data(), end))
+    {
+        return false;
+    }
+
+    Game loaded;
+    loaded.board = Board(BoardPreset(data[5]));
+    Board& board = loaded.board;
+    const uint8_t* header = &data[6];
+    loaded.tick = int(readLE(header, 4));
+    loaded.seed = readLE(header + 4, 8);
+    loaded.rngState = readLE(header + 12, 8);
+    loaded.score = int(readLE(header + 20, 4));
+    loaded.pieces = int(readLE(header + 24, 4));
+    loaded.lines = int(readLE(header + 28, 4));
+    loaded.boardGen = int(readLE(header + 32, 4));
+    loaded.tickAccumulator = readFloat(header + 36);
+    loaded.tickPeriod = readFloat(header + 40);
+    loaded.ticksToLock = header[44];
+    loaded.tickLockAccumulator = header[45];
+    loaded.maxCatchUpTicks = header[46];
+    loaded.gameOver = (header[47] & 1) != 0;
+    loaded.clearAllAtOnce = (header[47] & 2) != 0;
+    loaded.cascadeGravity = (header[47] & 4) != 0;
+
+    std::size_t pos = SNAPSHOT_HEADER_SIZE;
+    loaded.floatingPieceColor = data[pos++];
+    if (loaded.floatingPieceColor != 0)
+    {
+        if (pos + 4 > end)
+        {
+            return false;
+        }
+        loaded.pieceType = data[pos] >> 5;
+        loaded.pieceOrientation = data[pos] & 0x1F;
+        loaded.pieceX = data[pos + 1];
+        loaded.pieceY = data[pos + 2];
+        loaded.pieceZ = data[pos + 3];
+        pos += 4;
+        if (loaded.pieceType >= PIECE_TYPES || loaded.pieceOrientation >= PIECES.orientationCount[loaded.pieceType])
+        {
+            return false;
+        }
+    }
+
+    std::size_t occupancyBytes = std::size_t(board.cellCount() + 7) / 8;
+    if (pos + occupancyBytes > end)
+    {
+        return false;
+    }
+    uint32_t bits = 0;
+    int bitCount = 0;
+    for (auto& row : board.rows)
+    {
+        while (bitCount < board.width)
+        {
+            bits |= uint32_t(data[pos++]) << bitCount;
+            bitCount += 8;
+        }
+        row = BoardRow(bits & ((1U << board.width) - 1));
+        bits >>= board.width;
+        bitCount -= board.width;
+    }
+
+    uint32_t runLength = 0;
+    uint8_t runColor = 0;
+    for (int rowIndex = 0; rowIndex < int(board.rows.size()); rowIndex++)
+    {
+        for (BoardRow row = board.rows[rowIndex]; row != 0; row &= BoardRow(row - 1))
+        {
+            if (runLength == 0)
+            {
+                if (!readVarint(data, pos, runLength) || runLength == 0 || pos >= end || data[pos] == 0)
+                {
+                    return false;
+                }
+                runColor = data[pos++];
+            }
+            board.colors[std::size_t(rowIndex * board.width + std::countr_zero(row))] = runColor;
+            runLength--;
+        }
+    }
+    if (runLength != 0 || pos != end)
+    {
+        return false;
+    }
+    board.rebuildHeights();
+    board.markAllDirty();
+
+    if (loaded.floatingPieceColor != 0)
+    {
+        const auto& shape = PIECES.orientations[loaded.pieceType][loaded.pieceOrientation];
+        for (const auto& block : shape)
+        {
+            int x = loaded.pieceX + block.x;
+            int y = loaded.pieceY + block.y;
+            int z = loaded.pieceZ + block.z;
+            if (!board.inBounds(x, y, z) || board.occupied(x, y, z))
+            {
+                return false;
+            }
+            loaded.blockX.push_back(x);
+            loaded.blockY.push_back(y);
+            loaded.blockZ.push_back(z);
+        }
+    }
+    loaded.events = PIECE_SPAWNED;
+
+    game = std::move(loaded);
+    return true;
+}
+
+bool saveSnapshot(const Game& game, const std::string& path)
+{
+    std::vector<uint8_t> data;
+    saveSnapshot(game, data);
+    return writeFile(path, data);
+}
+
+bool loadSnapshot(const std::string& path, Game& game)
+{
+    std::vector<uint8_t> data;
+    return readFile(path, data) && loadSnapshot(data, game);
+}
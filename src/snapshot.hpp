@@ -0,0 +1,24 @@
+#pragma once
+
+#include "game.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Saves and loads the whole state of a game in a compact binary format, for save states, crash dumps and test
+// fixtures. After a header with the magic, version, board preset and the game's counters come:
+//  - the floating piece, as its color and, if it has one, its type and orientation in one byte and its pivot in three,
+//    as its blocks follow from those;
+//  - the occupancy of every cell, one bit each, in cell index order;
+//  - the colors of the occupied cells, in the same order, run length encoded as a varint count and a color byte;
+//  - an FNV-1a checksum of everything before it.
+// The occupancy of a classic board takes 125 bytes, and its colors a couple of bytes per run, where the reflection
+// schema visits every cell on its own.
+void saveSnapshot(const Game& game, std::vector<uint8_t>& data);
+// Replaces the game with the snapshot. Returns false, leaving the game alone, if the snapshot is truncated, corrupt
+// or from a newer version. Every cell and the floating piece are marked as changed, so presenters redraw the game.
+bool loadSnapshot(const std::vector<uint8_t>& data, Game& game);
+
+bool saveSnapshot(const Game& game, const std::string& path);
+bool loadSnapshot(const std::string& path, Game& game);
@@ -0,0 +1,155 @@
+#include "threadPool.hpp"
+
+#include <algorithm>
+
+// Index of the worker running on this thread, used to push nested tasks to the local queue.
+static thread_local unsigned currentWorker = ~0U;
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0)
+    {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threads; i++)
+    {
+        mWorkers.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned i = 0; i < threads; i++)
+    {
+        mThreads.emplace_back([this, i] { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+    for (auto& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    unsigned target = currentWorker < size() ? currentWorker : mNext.fetch_add(1) % size();
+    {
+        std::lock_guard<std::mutex> lock(mWorkers[target]->mutex);
+        mWorkers[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mQueued++;
+    }
+    mWake.notify_one();
+}
+
+bool ThreadPool::runOne(unsigned worker)
+{
+    std::function<void()> task;
+    for (unsigned i = 0; i < size() && !task; i++)
+    {
+        auto& victim = *mWorkers[(worker + i) % size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty())
+        {
+            continue;
+        }
+
+        // Take the newest task from our own queue, which is likely still in cache, and the oldest from others.
+        if (i == 0)
+        {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+
+    if (!task)
+    {
+        return false;
+    }
+    mQueued--;
+    task();
+    return true;
+}
+
+void ThreadPool::run(unsigned worker)
+{
+    currentWorker = worker;
+    while (true)
+    {
+        if (runOne(worker))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mSleepMutex);
+        mWake.wait(lock, [this] { return mStop || mQueued > 0; });
+        if (mStop)
+        {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& fn)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    // A few chunks per worker, so that stealing can even out the load.
+    int chunks = std::min(count, int(size()) * 4);
+    int chunkSize = (count + chunks - 1) / chunks;
+    chunks = (count + chunkSize - 1) / chunkSize;
+
+    // Chunks still running. The caller sleeps on done once there is nothing left for it to take.
+    std::mutex mutex;
+    std::condition_variable done;
+    int remaining = chunks;
+    for (int c = 0; c < chunks; c++)
+    {
+        int begin = c * chunkSize;
+        int end = std::min(count, begin + chunkSize);
+        submit([&fn, &mutex, &done, &remaining, begin, end] {
+            for (int i = begin; i < end; i++)
+            {
+                fn(i);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0)
+            {
+                done.notify_all();
+            }
+        });
+    }
+
+    // Every chunk was queued above, so once no task can be taken the rest are already running elsewhere.
+    unsigned self = currentWorker < size() ? currentWorker : 0;
+    while (runOne(self))
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (remaining == 0)
+        {
+            return;
+        }
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&remaining] { return remaining == 0; });
+}
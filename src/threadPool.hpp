@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Each worker has its own task queue, and idle workers steal from the others, so uneven
+// tasks still keep every core busy.
+class ThreadPool
+{
+public:
+    // Uses one worker per hardware thread if threads is 0.
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Pool shared by everything which doesn't need its own.
+    static ThreadPool& shared();
+
+    unsigned size() const
+    {
+        return unsigned(mWorkers.size());
+    }
+
+    void submit(std::function<void()> task);
+
+    // Calls fn(i) for every i in [0, count), split in chunks across the pool, and waits for all of them. The calling
+    // thread runs tasks too while it waits, so this may be called from inside a task.
+    void parallelFor(int count, const std::function<void(int)>& fn);
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Runs a task from the given worker's queue, or stolen from another one. Returns false if every queue is empty.
+    bool runOne(unsigned worker);
+    void run(unsigned worker);
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+    std::vector<std::thread> mThreads;
+    std::atomic<unsigned> mNext{0};
+    std::atomic<int> mQueued{0};
+    std::mutex mSleepMutex;
+    std::condition_variable mWake;
+    bool mStop = false;
+};
@@ -0,0 +1,92 @@
+#include "timings.hpp"
+
+#include "profiler.hpp"
+
+#include <cubos/core/ecs/reflection.hpp>
+#include <cubos/core/reflection/external/primitives.hpp>
+
+#include <cubos/engine/imgui/plugin.hpp>
+#include <cubos/engine/settings/plugin.hpp>
+#include <cubos/engine/tools/toolbox/plugin.hpp>
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <string>
+
+using namespace cubos::engine;
+
+CUBOS_REFLECT_IMPL(StartupTimer)
+{
+    return cubos::core::ecs::TypeBuilder<StartupTimer>("StartupTimer")
+        .withField("milliseconds", &StartupTimer::milliseconds)
+        .build();
+}
+
+void timingsPlugin(Cubos& cubos)
+{
+    cubos.depends(imguiPlugin);
+    cubos.depends(settingsPlugin);
+    cubos.depends(toolboxPlugin);
+
+    cubos.resource<StartupTimer>();
+
+    cubos.startupSystem("start recording a trace").after(settingsTag).call([](Settings& settings) {
+        if (!settings.getString("profiler.trace", "").empty())
+        {
+            Profiler::instance().startTrace();
+        }
+    });
+
+    cubos.system("show game timings").tagged(imguiTag).call([](Settings& settings, Toolbox& toolbox,
+                                                               const StartupTimer& startup) {
+        // Each frame is closed here, so the tool always shows complete frames.
+        Profiler::instance().endFrame();
+
+        if (!toolbox.isOpen("Game Timings"))
+        {
+            return;
+        }
+
+        ImGui::Begin("Game Timings");
+
+        std::string tracePath = settings.getString("profiler.trace", "trace.json");
+        if (Profiler::instance().tracing())
+        {
+            if (ImGui::Button("Save trace"))
+            {
+                Profiler::instance().saveTrace(tracePath);
+            }
+        }
+        else if (ImGui::Button("Record trace"))
+        {
+            Profiler::instance().startTrace();
+        }
+        ImGui::SameLine();
+        ImGui::TextUnformatted(tracePath.c_str());
+
+        if (startup.reported())
+        {
+            ImGui::Text("First playable frame after %.1f ms, assets from %s", double(startup.milliseconds),
+                        startup.assetSource);
+        }
+
+        for (const auto& series : Profiler::instance().series())
+        {
+            float sum = 0.0F;
+            float max = 0.0F;
+            for (float frame : series.frames)
+            {
+                sum += frame;
+                max = std::max(max, frame);
+            }
+
+            char overlay[64];
+            snprintf(overlay, sizeof(overlay), "avg %.3f ms, max %.3f ms", sum / PROFILE_HISTORY, max);
+            ImGui::PlotHistogram(series.name, series.frames.data(), PROFILE_HISTORY, series.offset, overlay, 0.0F,
+                                 std::max(max, 0.001F), ImVec2(0.0F, 40.0F));
+        }
+
+        ImGui::End();
+    });
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cubos/engine/prelude.hpp>
+
+#include <chrono>
+
+// Time from startup to the first playable frame, which is reported once and then shown in the "Game Timings" tool.
+struct StartupTimer
+{
+    CUBOS_REFLECT;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // Where the assets were read from.
+    const char* assetSource = "loose files";
+    float milliseconds = -1.0F;
+
+    bool reported() const
+    {
+        return milliseconds >= 0.0F;
+    }
+};
+
+// Shows the time spent in each profiled scope in the "Game Timings" tool, and records Chrome traces on demand.
+// Setting "profiler.trace" to a path starts recording a trace on startup, which is saved there from the tool.
+void timingsPlugin(cubos::engine::Cubos& cubos);
@@ -0,0 +1,123 @@
+#include "udpSocket.hpp"
+
+#include "log.hpp"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Largest datagram received. Anything longer is truncated, and then rejected by the packet parser.
+static const std::size_t MAX_DATAGRAM = 1500;
+
+UdpSocket::~UdpSocket()
+{
+    close();
+}
+
+bool UdpSocket::open(uint16_t localPort, const std::string& peerHost, uint16_t peerPort)
+{
+    close();
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+    {
+        return false;
+    }
+#endif
+
+    in_addr peer{};
+    if (inet_pton(AF_INET, peerHost.c_str(), &peer) != 1)
+    {
+        GAME_ERROR("The peer address is not an IPv4 address");
+        return false;
+    }
+    mPeerAddress = peer.s_addr;
+    mPeerPort = htons(peerPort);
+
+    mSocket = Handle(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+    if (mSocket == INVALID)
+    {
+        return false;
+    }
+
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(localPort);
+    if (bind(mSocket, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0)
+    {
+        GAME_ERROR("Could not bind UDP port {}", localPort);
+        close();
+        return false;
+    }
+
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    bool ok = ioctlsocket(mSocket, FIONBIO, &nonBlocking) == 0;
+#else
+    bool ok = fcntl(mSocket, F_SETFL, fcntl(mSocket, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+    if (!ok)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void UdpSocket::close()
+{
+    if (mSocket == INVALID)
+    {
+        return;
+    }
+#ifdef _WIN32
+    closesocket(mSocket);
+    WSACleanup();
+#else
+    ::close(mSocket);
+#endif
+    mSocket = INVALID;
+}
+
+bool UdpSocket::send(const std::vector<uint8_t>& data)
+{
+    sockaddr_in peer{};
+    peer.sin_family = AF_INET;
+    peer.sin_addr.s_addr = mPeerAddress;
+    peer.sin_port = mPeerPort;
+    auto sent = sendto(mSocket, reinterpret_cast<const char*>(data.data()), int(data.size()), 0,
+                       reinterpret_cast<const sockaddr*>(&peer), sizeof(peer));
+    return sent == decltype(sent)(data.size());
+}
+
+bool UdpSocket::receive(std::vector<uint8_t>& data)
+{
+    data.resize(MAX_DATAGRAM);
+    while (true)
+    {
+        sockaddr_in from{};
+        socklen_t fromSize = sizeof(from);
+        auto received = recvfrom(mSocket, reinterpret_cast<char*>(data.data()), int(data.size()), 0,
+                                 reinterpret_cast<sockaddr*>(&from), &fromSize);
+        if (received < 0)
+        {
+            // Nothing left to read, or an error left behind by an earlier datagram the peer wasn't there for.
+            data.clear();
+            return false;
+        }
+        if (from.sin_addr.s_addr == mPeerAddress && from.sin_port == mPeerPort)
+        {
+            data.resize(std::size_t(received));
+            return true;
+        }
+    }
+}
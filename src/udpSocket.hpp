@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Non-blocking UDP socket bound to a local port, which sends to a single peer. Datagrams are sent as they are, so
+// whatever uses it has to cope with them being lost, duplicated or reordered.
+class UdpSocket
+{
+public:
+    UdpSocket() = default;
+    ~UdpSocket();
+
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    // Binds to the given local port and sends to the given IPv4 address and port. Returns false if either fails.
+    bool open(uint16_t localPort, const std::string& peerHost, uint16_t peerPort);
+    void close();
+
+    bool isOpen() const
+    {
+        return mSocket != INVALID;
+    }
+
+    // Sends a datagram to the peer. Returns false if it couldn't be sent, such as while the peer isn't listening yet.
+    bool send(const std::vector<uint8_t>& data);
+
+    // Reads the next datagram from the peer into data. Returns false, without waiting, if there is none. Datagrams
+    // from anywhere else are dropped.
+    bool receive(std::vector<uint8_t>& data);
+
+private:
+#ifdef _WIN32
+    using Handle = uintptr_t;
+    static constexpr Handle INVALID = ~Handle(0);
+#else
+    using Handle = int;
+    static constexpr Handle INVALID = -1;
+#endif
+
+    Handle mSocket = INVALID;
+    uint32_t mPeerAddress = 0;
+    uint16_t mPeerPort = 0;
+};
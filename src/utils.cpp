@@ -2,7 +2,17 @@
 
 #include <glm/vec3.hpp>
 
-glm::vec3 gridToWorld(int x, int y, int z)
+glm::vec3 boardCorner(const Board& board)
 {
-    return LEFT_CORNER + glm::vec3(float(x * CUBE_SCALE), float(y * CUBE_SCALE), float(z * CUBE_SCALE));
-}
\ No newline at end of file
+    return CENTER_POS - glm::vec3(CUBE_SCALE * float(board.width / 2), CUBE_SCALE * 5, 0);
+}
+
+glm::vec3 gridToWorld(const Board& board, int x, int y, int z)
+{
+    return boardCorner(board) + glm::vec3(float(x * CUBE_SCALE), float(y * CUBE_SCALE), float(z * CUBE_SCALE));
+}
+
+glm::vec3 boardOrigin(const Board& board, int index)
+{
+    return glm::vec3(0.0f, 0.0f, float(index * (board.depth + BOARD_SPACING)) * CUBE_SCALE);
+}
@@ -2,9 +2,18 @@
 
 #include <glm/vec3.hpp>
 
+#include "board.hpp"
+
 const float CUBE_SCALE = 5.0f;
 const glm::vec3 CENTER_POS = glm::vec3(0.0f);
 
-const glm::vec3 LEFT_CORNER = CENTER_POS - glm::vec3(CUBE_SCALE * 5, CUBE_SCALE * 5, 0);
+// World position of cell (0, 0, 0), placed so that the board stays centered along x whatever its size.
+glm::vec3 boardCorner(const Board& board);
+
+glm::vec3 gridToWorld(const Board& board, int x, int y, int z);
 
-glm::vec3 gridToWorld(int x, int y, int z);
\ No newline at end of file
+// Cells left empty between boards laid out side by side.
+const int BOARD_SPACING = 4;
+// Offset of the board with the given index, for boards laid out side by side along z, the first one where a lone
+// board would be.
+glm::vec3 boardOrigin(const Board& board, int index);
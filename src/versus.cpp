@@ -0,0 +1,335 @@
+#include "versus.hpp"
+
+#include "bytes.hpp"
+#include "log.hpp"
+#include "profiler.hpp"
+#include "snapshot.hpp"
+
+#include <algorithm>
+
+static const char VERSUS_MAGIC[3] = {'C', 'J', 'V'};
+static const uint8_t VERSUS_VERSION = 1;
+// Magic, version, match and the sender's input delay.
+static const std::size_t VERSUS_HEADER_SIZE = 3 + 1 + 4 + 1;
+// Inputs stop being added to a packet past this size, so that it fits in a datagram. The rest go in the next one.
+static const std::size_t VERSUS_PACKET_BUDGET = 1200;
+
+// What a side predicts the peer did on a tick it hasn't heard about yet.
+static const VersusInput NO_INPUT{};
+
+void startVersus(VersusState& state, BoardPreset preset, uint64_t seed)
+{
+    state = VersusState{};
+    for (Game& game : state.games)
+    {
+        game.board = Board(preset);
+        seedGame(game, seed);
+    }
+}
+
+void stepVersus(VersusState& state, const VersusInput& first, const VersusInput& second)
+{
+    const VersusInput* inputs[VERSUS_PLAYERS] = {&first, &second};
+    for (int player = 0; player < VERSUS_PLAYERS; player++)
+    {
+        Game& game = state.games[player];
+        if (game.gameOver)
+        {
+            continue;
+        }
+        for (uint8_t action : *inputs[player])
+        {
+            if (action < ACTION_COUNT)
+            {
+                applyAction(game, Action(action));
+            }
+        }
+
+        // Garbage goes in between pieces, so that it never pushes the floating one into the board.
+        if (state.pendingGarbage[player] > 0 && game.floatingPieceColor == 0)
+        {
+            addGarbage(game, state.pendingGarbage[player]);
+            state.pendingGarbage[player] = 0;
+        }
+        tickGame(game);
+    }
+
+    for (int player = 0; player < VERSUS_PLAYERS; player++)
+    {
+        int earned = state.games[player].lines / VERSUS_LINES_PER_GARBAGE;
+        state.pendingGarbage[1 - player] += earned - state.sentGarbage[player];
+        state.sentGarbage[player] = earned;
+    }
+    state.tick++;
+}
+
+uint32_t hashVersus(const VersusState& state, std::vector<uint8_t>& scratch)
+{
+    uint32_t hash = 2166136261U;
+    for (const Game& game : state.games)
+    {
+        saveSnapshot(game, scratch);
+        hash = fnv1a(scratch.data(), scratch.size(), hash);
+    }
+
+    scratch.clear();
+    writeLE(scratch, uint32_t(state.tick), 4);
+    for (int player = 0; player < VERSUS_PLAYERS; player++)
+    {
+        writeLE(scratch, uint32_t(state.pendingGarbage[player]), 4);
+        writeLE(scratch, uint32_t(state.sentGarbage[player]), 4);
+    }
+    return fnv1a(scratch.data(), scratch.size(), hash);
+}
+
+int versusWinner(const VersusState& state)
+{
+    bool firstLost = state.games[0].gameOver;
+    bool secondLost = state.games[1].gameOver;
+    if (firstLost && secondLost)
+    {
+        return VERSUS_PLAYERS;
+    }
+    return firstLost ? 1 : secondLost ? 0 : -1;
+}
+
+void startVersusSession(VersusSession& session, int side, int inputDelay, int maxRollback, BoardPreset preset,
+                        uint64_t seed)
+{
+    session.side = side;
+    session.inputDelay = std::clamp(inputDelay, 0, VERSUS_MAX_INPUT_DELAY);
+    session.maxRollback = std::clamp(maxRollback, 1, VERSUS_MAX_ROLLBACK);
+
+    std::vector<uint8_t> id;
+    writeLE(id, seed, 8);
+    id.push_back(uint8_t(preset));
+    session.matchId = fnv1a(id.data(), id.size());
+
+    startVersus(session.state, preset, seed);
+    for (auto& inputs : session.inputs)
+    {
+        for (auto& input : inputs)
+        {
+            input.clear();
+        }
+    }
+
+    // Nobody has inputs on the ticks before their input delay.
+    session.localTick = session.inputDelay;
+    session.remoteTick = 0;
+    session.peerAck = session.inputDelay;
+    session.rollbackFrom = -1;
+    session.hashedTick = 0;
+    session.peerHashTick = -1;
+    session.desyncTick = -1;
+    session.winner = -1;
+    session.resultTick = -1;
+    session.rollbacks = 0;
+    session.resimulatedTicks = 0;
+    session.packetsSent = 0;
+    session.bytesSent = 0;
+}
+
+bool versusWantsInput(const VersusSession& session)
+{
+    return session.localTick <= session.state.tick + session.inputDelay &&
+           session.localTick - session.peerAck < VERSUS_HISTORY - 1;
+}
+
+void addVersusInput(VersusSession& session, const VersusInput& input)
+{
+    session.inputs[session.side][session.localTick % VERSUS_HISTORY] = input;
+    session.localTick++;
+}
+
+int confirmedVersusTick(const VersusSession& session)
+{
+    return std::min(session.remoteTick, session.state.tick);
+}
+
+static void simulateTick(VersusSession& session)
+{
+    int tick = session.state.tick;
+    session.saved[tick % VERSUS_HISTORY] = session.state;
+
+    const VersusInput* inputs[VERSUS_PLAYERS];
+    inputs[session.side] = &session.inputs[session.side][tick % VERSUS_HISTORY];
+    int remote = 1 - session.side;
+    inputs[remote] = tick < session.remoteTick ? &session.inputs[remote][tick % VERSUS_HISTORY] : &NO_INPUT;
+    stepVersus(session.state, *inputs[0], *inputs[1]);
+}
+
+static void checkPeerHash(VersusSession& session)
+{
+    int tick = session.peerHashTick;
+    if (tick < 0 || tick >= session.hashedTick)
+    {
+        return;
+    }
+    if (tick >= session.hashedTick - VERSUS_HISTORY && session.hashes[tick % VERSUS_HISTORY] != session.peerHash &&
+        session.desyncTick == -1)
+    {
+        GAME_ERROR("Desync after tick {}", tick);
+        session.desyncTick = tick;
+    }
+    session.peerHashTick = -1;
+}
+
+// Hashes the state after each newly confirmed tick, and looks for the result of the match in it.
+static void confirmTicks(VersusSession& session)
+{
+    int confirmed = confirmedVersusTick(session);
+    for (; session.hashedTick < confirmed; session.hashedTick++)
+    {
+        int tick = session.hashedTick;
+        const VersusState& after =
+            tick + 1 == session.state.tick ? session.state : session.saved[(tick + 1) % VERSUS_HISTORY];
+        session.hashes[tick % VERSUS_HISTORY] = hashVersus(after, session.scratch);
+        if (session.winner == -1)
+        {
+            session.winner = versusWinner(after);
+            session.resultTick = session.winner == -1 ? -1 : tick + 1;
+        }
+    }
+    checkPeerHash(session);
+}
+
+int advanceVersus(VersusSession& session)
+{
+    PROFILE_SCOPE("versus: advance");
+
+    if (session.rollbackFrom != -1)
+    {
+        PROFILE_SCOPE("versus: rollback");
+        int latest = session.state.tick;
+        session.state = session.saved[session.rollbackFrom % VERSUS_HISTORY];
+        while (session.state.tick < latest)
+        {
+            simulateTick(session);
+            session.resimulatedTicks++;
+        }
+        session.rollbacks++;
+        session.rollbackFrom = -1;
+    }
+
+    int advanced = 0;
+    while (session.state.tick < session.localTick && session.state.tick - session.remoteTick < session.maxRollback)
+    {
+        simulateTick(session);
+        advanced++;
+    }
+
+    confirmTicks(session);
+    return advanced;
+}
+
+void writeVersusPacket(VersusSession& session, std::vector<uint8_t>& packet)
+{
+    packet.assign(VERSUS_MAGIC, VERSUS_MAGIC + 3);
+    packet.push_back(VERSUS_VERSION);
+    writeLE(packet, session.matchId, 4);
+    packet.push_back(uint8_t(session.inputDelay));
+
+    // Every input the peer hasn't acknowledged, oldest first, for as many ticks as fit.
+    std::vector<uint8_t> ticks;
+    int count = 0;
+    for (int tick = session.peerAck; tick < session.localTick && ticks.size() < VERSUS_PACKET_BUDGET; tick++, count++)
+    {
+        const VersusInput& input = session.inputs[session.side][tick % VERSUS_HISTORY];
+        writeVarint(ticks, uint32_t(input.size()));
+        ticks.insert(ticks.end(), input.begin(), input.end());
+    }
+    writeVarint(packet, uint32_t(session.peerAck));
+    writeVarint(packet, uint32_t(count));
+    packet.insert(packet.end(), ticks.begin(), ticks.end());
+
+    writeVarint(packet, uint32_t(session.remoteTick));
+    if (session.hashedTick > 0)
+    {
+        writeVarint(packet, uint32_t(session.hashedTick));
+        writeLE(packet, session.hashes[(session.hashedTick - 1) % VERSUS_HISTORY], 4);
+    }
+    else
+    {
+        writeVarint(packet, 0);
+    }
+
+    session.packetsSent++;
+    session.bytesSent += (long long)packet.size();
+}
+
+bool readVersusPacket(VersusSession& session, const std::vector<uint8_t>& packet)
+{
+    if (packet.size() < VERSUS_HEADER_SIZE || !std::equal(VERSUS_MAGIC, VERSUS_MAGIC + 3, packet.begin()) ||
+        packet[3] != VERSUS_VERSION || uint32_t(readLE(&packet[4], 4)) != session.matchId)
+    {
+        return false;
+    }
+    int peerDelay = packet[8];
+
+    // Read everything before changing anything, so that a truncated packet is dropped as a whole.
+    std::size_t pos = VERSUS_HEADER_SIZE;
+    uint32_t first, count;
+    if (!readVarint(packet, pos, first) || !readVarint(packet, pos, count) || count > uint32_t(VERSUS_HISTORY))
+    {
+        return false;
+    }
+    session.received.resize(count);
+    for (auto& input : session.received)
+    {
+        uint32_t actions;
+        if (!readVarint(packet, pos, actions) || actions > packet.size() - pos)
+        {
+            return false;
+        }
+        input.assign(packet.begin() + std::ptrdiff_t(pos), packet.begin() + std::ptrdiff_t(pos + actions));
+        pos += actions;
+    }
+    uint32_t ack, hashedTick;
+    if (!readVarint(packet, pos, ack) || !readVarint(packet, pos, hashedTick) ||
+        (hashedTick > 0 && packet.size() - pos < 4))
+    {
+        return false;
+    }
+    uint32_t hash = hashedTick > 0 ? uint32_t(readLE(&packet[pos], 4)) : 0;
+    if (peerDelay > VERSUS_MAX_INPUT_DELAY || first > uint32_t(session.remoteTick) + uint32_t(peerDelay))
+    {
+        return false;
+    }
+
+    // The peer has no inputs on the ticks before its input delay, which is what was predicted for them.
+    int remote = 1 - session.side;
+    for (; session.remoteTick < peerDelay; session.remoteTick++)
+    {
+        session.inputs[remote][session.remoteTick % VERSUS_HISTORY].clear();
+    }
+
+    // Inputs are only taken in order. Ones already known are resent duplicates.
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int tick = int(first + i);
+        if (tick != session.remoteTick)
+        {
+            continue;
+        }
+        VersusInput& input = session.inputs[remote][tick % VERSUS_HISTORY];
+        input = session.received[i];
+
+        // Ticks already simulated assumed the peer did nothing.
+        if (tick < session.state.tick && !input.empty() &&
+            (session.rollbackFrom == -1 || tick < session.rollbackFrom))
+        {
+            session.rollbackFrom = tick;
+        }
+        session.remoteTick++;
+    }
+
+    session.peerAck = std::clamp(int(ack), session.peerAck, session.localTick);
+    if (hashedTick > 0 && int(hashedTick) - 1 > session.peerHashTick)
+    {
+        session.peerHashTick = int(hashedTick) - 1;
+        session.peerHash = hash;
+        checkPeerHash(session);
+    }
+    return true;
+}
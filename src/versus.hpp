@@ -0,0 +1,112 @@
+#pragma once
+
+#include "game.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Two player versus over the network, in lockstep: both sides run both games from the same seed, and only exchange
+// the inputs of each tick. A side doesn't wait for the other's inputs, but predicts that there are none, and rolls
+// back and simulates again when they turn out otherwise.
+
+const int VERSUS_PLAYERS = 2;
+// Ticks of inputs and states kept. Bounds the input delay plus how far a side can run ahead of its peer.
+const int VERSUS_HISTORY = 64;
+const int VERSUS_MAX_INPUT_DELAY = 16;
+const int VERSUS_MAX_ROLLBACK = 32;
+// Lines a player clears for each garbage layer sent to the opponent.
+const int VERSUS_LINES_PER_GARBAGE = 4;
+
+// Everything the outcome of a match depends on. Both sides compute it from the same inputs, so it is only ever
+// compared through its hash, and never sent.
+struct VersusState
+{
+    std::array<Game, VERSUS_PLAYERS> games{};
+    // Garbage layers waiting to be added under each player's board, which happens once it has no floating piece.
+    std::array<int, VERSUS_PLAYERS> pendingGarbage{};
+    // Garbage layers each player has sent so far.
+    std::array<int, VERSUS_PLAYERS> sentGarbage{};
+    int tick = 0;
+};
+
+// Actions of one player on one tick.
+using VersusInput = std::vector<uint8_t>;
+
+// Both players get the same seed, and so the same pieces.
+void startVersus(VersusState& state, BoardPreset preset, uint64_t seed);
+// Runs a tick of both games with the given inputs, and sends the garbage earned by line clears across.
+void stepVersus(VersusState& state, const VersusInput& first, const VersusInput& second);
+// Hash of everything in the state, using scratch for the snapshots of the games.
+uint32_t hashVersus(const VersusState& state, std::vector<uint8_t>& scratch);
+// Index of the player who won, VERSUS_PLAYERS if both lost on the same tick, or -1 while both are playing.
+int versusWinner(const VersusState& state);
+
+// One side of a match. Local inputs are applied inputDelay ticks after they are made, which hides that much latency
+// without rolling back. Packets carry every input the peer hasn't acknowledged yet, so losing some only delays them,
+// and the hash of the last tick confirmed by both sides, so that a desync is caught on the tick it happens.
+struct VersusSession
+{
+    int side = 0;
+    int inputDelay = 3;
+    // Most ticks simulated past the last one with the peer's inputs. Past this the session stalls until they arrive.
+    int maxRollback = 8;
+    // Hash of the seed and board size, so that packets from a different match are ignored.
+    uint32_t matchId = 0;
+
+    VersusState state{};
+    // State before each of the last ticks, by tick modulo VERSUS_HISTORY, to roll back to.
+    std::array<VersusState, VERSUS_HISTORY> saved{};
+    // Inputs of each player, by tick modulo VERSUS_HISTORY.
+    std::array<std::array<VersusInput, VERSUS_HISTORY>, VERSUS_PLAYERS> inputs{};
+
+    // Local inputs are known for ticks before localTick, and the peer's for ticks before remoteTick. The peer has
+    // acknowledged the local inputs before peerAck.
+    int localTick = 0;
+    int remoteTick = 0;
+    int peerAck = 0;
+    // Earliest tick simulated with a prediction which turned out wrong, or -1.
+    int rollbackFrom = -1;
+
+    // Hash of the state after each confirmed tick, by tick modulo VERSUS_HISTORY. Known for ticks before hashedTick.
+    std::array<uint32_t, VERSUS_HISTORY> hashes{};
+    int hashedTick = 0;
+    // Last hash received from the peer, for a tick not hashed here yet, or -1.
+    int peerHashTick = -1;
+    uint32_t peerHash = 0;
+    // First tick on which the two sides disagree, or -1.
+    int desyncTick = -1;
+
+    // Result, once both sides agree on it: versusWinner on the confirmed tick it was decided, or -1.
+    int winner = -1;
+    int resultTick = -1;
+
+    int rollbacks = 0;
+    long long resimulatedTicks = 0;
+    long long packetsSent = 0;
+    long long bytesSent = 0;
+
+    std::vector<uint8_t> scratch{};
+    std::vector<VersusInput> received{};
+};
+
+void startVersusSession(VersusSession& session, int side, int inputDelay, int maxRollback, BoardPreset preset,
+                        uint64_t seed);
+
+// Whether the local input of the next tick can be added. False once the local side is as far ahead as its input
+// delay allows, or has as many inputs as it can keep unacknowledged.
+bool versusWantsInput(const VersusSession& session);
+void addVersusInput(VersusSession& session, const VersusInput& input);
+
+// Ticks for which both players' inputs are known and have been simulated.
+int confirmedVersusTick(const VersusSession& session);
+
+// Rolls back if a prediction was wrong, and then simulates every tick the known and predicted inputs allow. Hashes
+// the newly confirmed ticks and checks them against the peer's. Returns how many new ticks were simulated.
+int advanceVersus(VersusSession& session);
+
+// Packets: a header with the match, followed by the unacknowledged local inputs, the acknowledgement of the peer's
+// and the latest confirmed hash. Usually a dozen bytes, a few ticks' worth of inputs at a time.
+void writeVersusPacket(VersusSession& session, std::vector<uint8_t>& packet);
+// Returns false, changing nothing, if the packet is malformed or from another match.
+bool readVersusPacket(VersusSession& session, const std::vector<uint8_t>& packet);